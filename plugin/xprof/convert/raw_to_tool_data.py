@@ -27,8 +27,6 @@ import logging
 
 from xprof.convert import csv_writer
 from xprof.convert import dcn_collective_stats_proto_to_gviz
-from xprof.convert import trace_events_json
-from xprof.protobuf import trace_events_old_pb2
 
 try:
   from xprof.convert import _pywrap_profiler_plugin  # pylint: disable=g-import-not-at-top
@@ -40,10 +38,15 @@ logger = logging.getLogger('tensorboard')
 
 
 def process_raw_trace(raw_trace):
-  """Processes raw trace data and returns the UI data."""
-  trace = trace_events_old_pb2.Trace()
-  trace.ParseFromString(raw_trace)
-  return ''.join(trace_events_json.TraceEventsJsonStream(trace))
+  """Processes raw trace data and returns the UI data.
+
+  Args:
+    raw_trace: A serialized legacy Trace proto.
+
+  Returns:
+    The trace viewer JSON, as bytes.
+  """
+  return _pywrap_profiler_plugin.legacy_trace_to_json(raw_trace)
 
 
 def xspace_to_tools_data_from_byte_string(xspace_byte_list, filenames, tool,
@@ -85,6 +88,34 @@ def xspace_to_tool_names(xspace_paths):
   return []
 
 
+def _get_int_param(params, name, min_value=None):
+  """Reads an integer request parameter.
+
+  Args:
+    params: user input parameters.
+    name: the name of the parameter.
+    min_value: if set, the smallest accepted value.
+
+  Returns:
+    The parameter as an int.
+
+  Raises:
+    ValueError: if the parameter is not an integer or is below min_value.
+  """
+  value = params[name]
+  try:
+    int_value = int(value)
+  except (TypeError, ValueError):
+    raise ValueError(
+        'Invalid %s: %r; expected an integer' % (name, value)
+    ) from None
+  if min_value is not None and int_value < min_value:
+    raise ValueError(
+        'Invalid %s: %d; expected at least %d' % (name, int_value, min_value)
+    )
+  return int_value
+
+
 def xspace_to_tool_data(
     xspace_paths,
     tool,
@@ -117,6 +148,9 @@ def xspace_to_tool_data(
   if tool == 'trace_viewer':
     # Trace viewer handles one host at a time.
     assert len(xspace_paths) == 1
+    # Upper bound on the events sent to the browser; negative for no bound.
+    if 'max_events' in params:
+      options['max_events'] = _get_int_param(params, 'max_events')
     raw_data, success = xspace_wrapper_func(xspace_paths, tool, options)
     if success:
       data = process_raw_trace(raw_data)
@@ -227,6 +261,26 @@ def xspace_to_tool_data(
     json_data, success = xspace_wrapper_func(xspace_paths, tool, options)
     if success:
       data = json_data
+  elif tool == 'op_metrics_query':
+    options['query'] = params.get('query', '')
+    # If set, the query runs over each time slice of this duration.
+    if 'slice_duration_ms' in params:
+      options['slice_duration_ms'] = _get_int_param(
+          params, 'slice_duration_ms', min_value=0
+      )
+    json_data, success = xspace_wrapper_func(xspace_paths, tool, options)
+    if success:
+      data = json_data
+  elif tool == 'op_stats_diff':
+    # Comma separated XSpace paths of the session to compare against, resolved
+    # by the profile plugin from the baseline run.
+    options['baseline_xspace_paths'] = params.get('baseline_xspace_paths', '')
+    for threshold in ('min_delta_us', 'min_relative_delta'):
+      if threshold in params:
+        options[threshold] = str(params[threshold])
+    json_data, success = xspace_wrapper_func(xspace_paths, tool, options)
+    if success:
+      data = json_data
   else:
     logger.warning('%s is not a known xplane tool', tool)
   return data, content_type
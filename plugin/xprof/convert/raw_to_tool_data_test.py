@@ -44,6 +44,43 @@ class RawToToolDataTest(tf.test.TestCase):
     self.assertEqual(data, b"trace_viewer@")
     self.assertEqual(content_type, "application/json")
 
+  def test_trace_viewer_forwards_max_events(self):
+    received_options = []
+
+    def xspace_wrapper_func(paths, tool, options):
+      del paths, tool
+      received_options.append(options)
+      return b"", False
+
+    raw_to_tool_data.xspace_to_tool_data(
+        xspace_paths=["/path/to/xspace"],
+        tool="trace_viewer",
+        params={"max_events": "100", "use_saved_result": False},
+        xspace_wrapper_func=xspace_wrapper_func,
+    )
+
+    self.assertEqual(
+        received_options, [{"max_events": 100, "use_saved_result": False}]
+    )
+
+  def test_trace_viewer_rejects_invalid_max_events(self):
+    with self.assertRaisesRegex(ValueError, "Invalid max_events: 'lots'"):
+      raw_to_tool_data.xspace_to_tool_data(
+          xspace_paths=["/path/to/xspace"],
+          tool="trace_viewer",
+          params={"max_events": "lots"},
+          xspace_wrapper_func=lambda paths, tool, options: (b"", False),
+      )
+
+  def test_op_metrics_query_rejects_negative_slice_duration(self):
+    with self.assertRaisesRegex(ValueError, "Invalid slice_duration_ms: -1"):
+      raw_to_tool_data.xspace_to_tool_data(
+          xspace_paths=["/path/to/xspace"],
+          tool="op_metrics_query",
+          params={"slice_duration_ms": "-1"},
+          xspace_wrapper_func=lambda paths, tool, options: (b"", False),
+      )
+
 
 if __name__ == "__main__":
   tf.test.main()
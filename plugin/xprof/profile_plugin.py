@@ -119,6 +119,8 @@ XPLANE_TOOLS = [
     'memory_viewer',
     'graph_viewer',
     'megascale_stats',
+    'op_stats_diff',
+    'op_metrics_query',
 ]
 
 # XPlane generated tools that support all host mode.
@@ -129,11 +131,12 @@ XPLANE_TOOLS_ALL_HOSTS_SUPPORTED = frozenset([
     'overview_page',
     'pod_viewer',
     'megascale_stats',
+    'op_metrics_query',
 ])
 
 # XPlane generated tools that only support all host mode.
 XPLANE_TOOLS_ALL_HOSTS_ONLY = frozenset(
-    ['overview_page', 'pod_viewer'])
+    ['overview_page', 'pod_viewer', 'op_stats_diff'])
 
 # Rate limiter constants, the GCS quota defined below
 # https://cloud.google.com/storage/quotas#rate-quotas.
@@ -386,6 +389,26 @@ def filenames_to_hosts(filenames: list[str], tool: str) -> list[str]:
   return sorted(hosts)
 
 
+def all_hosts_xplane_paths(run_dir: str) -> List[epath.Path]:
+  """Returns the paths of the XPlane files of all hosts in a run directory.
+
+  Args:
+    run_dir: A profile run directory, as returned by `_run_dir`.
+
+  Raises:
+    IOError: If the run directory cannot be read.
+  """
+  file_pattern = make_filename('*', 'xplane')
+  try:
+    path = epath.Path(run_dir)
+    return list(path.glob(file_pattern))
+  except OSError as e:
+    logger.warning('Cannot read asset directory: %s, OpError %s', run_dir, e)
+    raise IOError(
+        'Cannot read asset directory: %s, OpError %s' % (run_dir, e)
+    ) from e
+
+
 def validate_xplane_asset_paths(asset_paths: List[str]) -> None:
   """Validates that all xplane asset paths that are provided are valid files.
 
@@ -677,6 +700,9 @@ class ProfilePlugin(base_plugin.TBPlugin):
 
     params['memory_space'] = request.args.get('memory_space', '0')
 
+    if tool == 'trace_viewer' and request.args.get('max_events') is not None:
+      params['max_events'] = request.args.get('max_events')
+
     if tool == 'trace_viewer@':
       options = {}
       options['resolution'] = request.args.get('resolution', 8000)
@@ -684,23 +710,38 @@ class ProfilePlugin(base_plugin.TBPlugin):
         options['start_time_ms'] = request.args.get('start_time_ms')
       if request.args.get('end_time_ms') is not None:
         options['end_time_ms'] = request.args.get('end_time_ms')
+      # Layout of the trace table, used only when the table is first built.
+      for table_option in ('table_block_sizes', 'table_tiles_ps',
+                           'table_compression'):
+        if request.args.get(table_option) is not None:
+          options[table_option] = request.args.get(table_option)
       params['trace_viewer_options'] = options
 
+    if tool == 'op_metrics_query':
+      params['query'] = request.args.get('query', '')
+      if request.args.get('slice_duration_ms') is not None:
+        params['slice_duration_ms'] = request.args.get('slice_duration_ms')
+
+    if tool == 'op_stats_diff':
+      # The baseline is another run under the logdir, resolved like `run`.
+      baseline_run = request.args.get('baseline_run')
+      if not baseline_run:
+        raise ValueError('op_stats_diff requires a baseline_run')
+      baseline_paths = all_hosts_xplane_paths(self._run_dir(baseline_run))
+      validate_xplane_asset_paths(baseline_paths)
+      params['baseline_xspace_paths'] = ','.join(
+          os.fspath(path) for path in baseline_paths
+      )
+      for threshold in ('min_delta_us', 'min_relative_delta'):
+        if request.args.get(threshold) is not None:
+          params[threshold] = request.args.get(threshold)
+
     asset_path = os.path.join(run_dir, make_filename(host, tool))
 
     _, content_encoding = None, None
     if use_xplane(tool):
       if host == ALL_HOSTS:
-        file_pattern = make_filename('*', 'xplane')
-        try:
-          path = epath.Path(run_dir)
-          asset_paths = list(path.glob(file_pattern))
-        except OSError as e:
-          logger.warning('Cannot read asset directory: %s, OpError %s', run_dir,
-                         e)
-          raise IOError(
-              'Cannot read asset directory: %s, OpError %s' % (run_dir, e)
-          ) from e
+        asset_paths = all_hosts_xplane_paths(run_dir)
       else:
         asset_paths = [asset_path]
 
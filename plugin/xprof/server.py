@@ -26,6 +26,11 @@ from xprof.profile_plugin_loader import ProfilePluginLoader
 from xprof.standalone.base_plugin import TBContext
 from xprof.standalone.plugin_event_multiplexer import DataProvider
 
+try:
+  from xprof.convert import _pywrap_profiler_plugin  # pylint: disable=g-import-not-at-top
+except ImportError:
+  from xprof.pywrap import _pywrap_profiler_plugin  # pylint: disable=g-import-not-at-top
+
 
 def make_wsgi_app(plugin):
   """Create a WSGI application for the standalone server."""
@@ -102,7 +107,12 @@ def _get_wildcard_address(port) -> str:
   return fallback_address
 
 
-def launch_server(logdir, port):
+def launch_server(logdir, port, fast_file_dir=None):
+  """Starts the XProf server for the profiles in `logdir`."""
+  if fast_file_dir:
+    # Sessions without a writable run directory keep their trace viewer
+    # tables here.
+    _pywrap_profiler_plugin.register_fast_file_dir(fast_file_dir)
   context = TBContext(logdir, DataProvider(logdir), TBContext.Flags(False))
   loader = ProfilePluginLoader()
   plugin = loader.load(context)
@@ -170,6 +180,18 @@ def main() -> int:
       help="The port number for the server (default: %(default)s).",
   )
 
+  parser.add_argument(
+      "--fast_file_dir",
+      metavar="<dir>",
+      type=str,
+      default=None,
+      help=(
+          "Directory for the trace viewer tables of profiles whose run"
+          " directory is not writable. Any supported file system works,"
+          " e.g. ram://xprof."
+      ),
+  )
+
   try:
     args = parser.parse_args()
   except SystemExit as e:
@@ -190,5 +212,5 @@ def main() -> int:
     )
     return 1
 
-  launch_server(logdir, port)
+  launch_server(logdir, port, args.fast_file_dir)
   return 0
@@ -121,32 +121,37 @@ double GetThroughput(size_t data_size, uint64_t start_time_ps,
   return data_size / tsl::profiler::PicoToUni(end_time_ps - start_time_ps);
 }
 
-// Compute throughput and average latency.
+// Accumulates throughput and average latency over the data of one model.
 // DataType can either be RequestDetail or BatchDetail.
 template <typename DataType>
-std::pair<double, double> ComputeThroughputAndAverageLatencyUs(
-    const std::vector<const DataType*>& all_data) {
-  if (all_data.empty()) {
-    // Return 0 immediately to avoid divide by zero error.
-    return std::make_pair(0.0, 0.0);
+class ThroughputAndLatencyAccumulator {
+ public:
+  void Add(const DataType& data) {
+    min_start_time_ps_ = std::min(min_start_time_ps_, data.start_time_ps());
+    max_end_time_ps_ = std::max(max_end_time_ps_, data.end_time_ps());
+    total_latency_ps_ += (data.end_time_ps() - data.start_time_ps());
+    ++count_;
   }
 
-  uint64_t min_start_time_ps = std::numeric_limits<uint64_t>::max();
-  uint64_t max_end_time_ps = 0;
-  uint64_t total_latency_ps = 0;
-
-  for (const DataType* data : all_data) {
-    min_start_time_ps = std::min(min_start_time_ps, data->start_time_ps());
-    max_end_time_ps = std::max(max_end_time_ps, data->end_time_ps());
-    total_latency_ps += (data->end_time_ps() - data->start_time_ps());
+  // Returns the throughput and the average latency in microseconds.
+  std::pair<double, double> Get() const {
+    if (count_ == 0) {
+      // Return 0 immediately to avoid divide by zero error.
+      return std::make_pair(0.0, 0.0);
+    }
+    double throughput =
+        GetThroughput(count_, min_start_time_ps_, max_end_time_ps_);
+    double average_latency_us =
+        tsl::profiler::PicoToMicro(total_latency_ps_) / count_;
+    return std::make_pair(throughput, average_latency_us);
   }
 
-  double throughput =
-      GetThroughput(all_data.size(), min_start_time_ps, max_end_time_ps);
-  double average_latency_us =
-      tsl::profiler::PicoToMicro(total_latency_ps) / all_data.size();
-  return std::make_pair(throughput, average_latency_us);
-}
+ private:
+  uint64_t min_start_time_ps_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_end_time_ps_ = 0;
+  uint64_t total_latency_ps_ = 0;
+  size_t count_ = 0;
+};
 
 template <typename DataType>
 bool CompareByDuration(const DataType* a, const DataType* b) {
@@ -244,13 +249,18 @@ void GenerateTensorTransferAggregatedResult(PerModelInferenceStats* per_model) {
             ->add_tensor_pattern_results();
     tensor_pattern_result->set_tensor_pattern_index(index);
     tensor_pattern_result->set_count(events.size());
-    std::sort(events.begin(), events.end(),
-              [](const TensorEventDetail* a, const TensorEventDetail* b) {
-                return a->linearize_delinearize_time_ps() <
-                       b->linearize_delinearize_time_ps();
-              });
+    auto by_time = [](const TensorEventDetail* a, const TensorEventDetail* b) {
+      return a->linearize_delinearize_time_ps() <
+             b->linearize_delinearize_time_ps();
+    };
+    // kPercentiles is ascending, so each selection only needs to partition
+    // the events at or above the previous percentile.
+    auto unselected = events.begin();
     for (const double percentile : kPercentiles) {
       int index = static_cast<int>(percentile / 100.0 * events.size());
+      std::nth_element(unselected, events.begin() + index, events.end(),
+                       by_time);
+      unselected = events.begin() + index;
       auto* percentile_time =
           tensor_pattern_result->add_linearize_delinearize_percentile_time();
       percentile_time->set_percentile(percentile);
@@ -336,68 +346,58 @@ BatchDetail GetAverageBatchDetails(const BatchDetail& batch, int64_t size) {
   return result;
 }
 
-void AggregatePerModelInferenceStats(InferenceStats* inference_stats) {
-  for (auto& [model_index, per_model_stats] :
-       *inference_stats->mutable_inference_stats_per_model()) {
+// Aggregates the requests and batches of one model as they are regrouped.
+// All batches must be added before the requests, so that requests can be
+// attributed to the batch sizes of their related batches.
+class PerModelInferenceStatsAggregator {
+ public:
+  void AddBatch(const BatchDetail& b) {
     // TODO: remove batch size aggregation from request table.
-    absl::flat_hash_map<int /*batch_id*/, const BatchDetail*> batch_id_to_batch;
-    for (const BatchDetail& b : per_model_stats.batch_details()) {
-      batch_id_to_batch[b.batch_id()] = &b;
-    }
-
-    // Aggregated result for all data.
-    RequestDetail aggregated_r;
-    BatchDetail aggregated_b;
+    batch_id_to_batch_[b.batch_id()] = &b;
+    // Aggregate all data.
+    AggregateBatch(b, &aggregated_b_);
+    // Aggregate per batch size.
+    int batch_size = b.batch_size_after_padding();
+    auto& info = per_batch_size_info_[batch_size];
+    AggregateBatch(b, info.result.mutable_aggregated_batch_result());
+    info.batch_count++;
+  }
 
-    struct PerBatchSizeInfo {
-      PerBatchSizeAggregatedResult result;
-      int request_count;
-      int batch_count;
-    };
-    // Aggregated result per batch size.
-    absl::flat_hash_map<int /*batch_id*/, PerBatchSizeInfo> per_batch_size_info;
-
-    for (const RequestDetail& r : per_model_stats.request_details()) {
-      // Aggregate all data.
-      AggregateRequest(r, &aggregated_r);
-      // Aggregate per batch size.
-      // TODO: remove batch size aggregation from request table.
-      for (const auto batch_id : r.related_batch_ids()) {
-        if (const BatchDetail* batch =
-                ::tsl::gtl::FindPtrOrNull(batch_id_to_batch, batch_id)) {
-          int batch_size = batch->batch_size_after_padding();
-          auto& info = per_batch_size_info[batch_size];
-          AggregateRequest(r, info.result.mutable_aggregated_request_result());
-          info.request_count++;
-        }
+  void AddRequest(const RequestDetail& r) {
+    // Aggregate all data.
+    AggregateRequest(r, &aggregated_r_);
+    // Aggregate per batch size.
+    // TODO: remove batch size aggregation from request table.
+    for (const auto batch_id : r.related_batch_ids()) {
+      if (const BatchDetail* batch =
+              ::tsl::gtl::FindPtrOrNull(batch_id_to_batch_, batch_id)) {
+        int batch_size = batch->batch_size_after_padding();
+        auto& info = per_batch_size_info_[batch_size];
+        AggregateRequest(r, info.result.mutable_aggregated_request_result());
+        info.request_count++;
       }
     }
+  }
 
-    for (const BatchDetail& b : per_model_stats.batch_details()) {
-      // Aggregate all data.
-      AggregateBatch(b, &aggregated_b);
-      // Aggregate per batch size.
-      int batch_size = b.batch_size_after_padding();
-      auto& info = per_batch_size_info[batch_size];
-      AggregateBatch(b, info.result.mutable_aggregated_batch_result());
-      info.batch_count++;
-    }
-
+  // Writes the aggregated results to <per_model_stats>, whose request and
+  // batch details and throughputs must already be populated.
+  void Finalize(PerModelInferenceStats& per_model_stats) {
     *per_model_stats.mutable_aggregated_request_detail() =
-        GetAverageRequestDetails(aggregated_r,
+        GetAverageRequestDetails(aggregated_r_,
                                  per_model_stats.request_details().size());
     *per_model_stats.mutable_aggregated_batch_detail() = GetAverageBatchDetails(
-        aggregated_b, per_model_stats.batch_details().size());
+        aggregated_b_, per_model_stats.batch_details().size());
 
     std::vector<int> sorted_batch_sizes;
-    for (const auto& [batch_size, _] : per_batch_size_info) {
+    sorted_batch_sizes.reserve(per_batch_size_info_.size());
+    for (const auto& [batch_size, _] : per_batch_size_info_) {
       sorted_batch_sizes.push_back(batch_size);
     }
     std::sort(sorted_batch_sizes.begin(), sorted_batch_sizes.end());
     for (const int batch_size : sorted_batch_sizes) {
       auto* result = per_model_stats.add_per_batch_size_aggregated_result();
       result->set_batch_size(batch_size);
-      auto& info = per_batch_size_info[batch_size];
+      auto& info = per_batch_size_info_[batch_size];
       *result->mutable_aggregated_request_result() = GetAverageRequestDetails(
           info.result.aggregated_request_result(), info.request_count);
       result->set_request_throughput(info.request_count *
@@ -410,7 +410,22 @@ void AggregatePerModelInferenceStats(InferenceStats* inference_stats) {
                                    per_model_stats.batch_details_size());
     }
   }
-}
+
+ private:
+  struct PerBatchSizeInfo {
+    PerBatchSizeAggregatedResult result;
+    int request_count = 0;
+    int batch_count = 0;
+  };
+
+  absl::flat_hash_map<int /*batch_id*/, const BatchDetail*> batch_id_to_batch_;
+  // Aggregated result for all data.
+  RequestDetail aggregated_r_;
+  BatchDetail aggregated_b_;
+  // Aggregated result per batch size.
+  absl::flat_hash_map<int /*batch_size*/, PerBatchSizeInfo>
+      per_batch_size_info_;
+};
 
 }  // namespace
 
@@ -438,28 +453,38 @@ void RegroupInferenceStatsByModel(InferenceStats* inference_stats) {
   RegroupDataByModelId(inference_stats->model_id_db(), all_batches_by_host,
                        &batches_by_model_id);
 
+  // Copying the regrouped data, computing throughputs and aggregating is done
+  // in a single pass over the data of each model.
   for (size_t index = 0; index < requests_by_model_id.size(); index++) {
     auto* per_model =
         &(*inference_stats->mutable_inference_stats_per_model())[index];
-    for (const RequestDetail* request : requests_by_model_id[index]) {
-      *per_model->add_request_details() = *request;
-    }
+    PerModelInferenceStatsAggregator aggregator;
+    ThroughputAndLatencyAccumulator<BatchDetail> batch_accumulator;
+    per_model->mutable_batch_details()->Reserve(
+        batches_by_model_id[index].size());
     for (const BatchDetail* batch : batches_by_model_id[index]) {
       *per_model->add_batch_details() = *batch;
+      batch_accumulator.Add(*batch);
+      aggregator.AddBatch(*batch);
     }
-    auto [request_throughput, request_latency] =
-        ComputeThroughputAndAverageLatencyUs(requests_by_model_id[index]);
+    ThroughputAndLatencyAccumulator<RequestDetail> request_accumulator;
+    per_model->mutable_request_details()->Reserve(
+        requests_by_model_id[index].size());
+    for (const RequestDetail* request : requests_by_model_id[index]) {
+      *per_model->add_request_details() = *request;
+      request_accumulator.Add(*request);
+      aggregator.AddRequest(*request);
+    }
+    auto [request_throughput, request_latency] = request_accumulator.Get();
     per_model->set_request_throughput(request_throughput);
     per_model->set_request_average_latency_us(request_latency);
-    auto [batch_throughput, batch_latency] =
-        ComputeThroughputAndAverageLatencyUs(batches_by_model_id[index]);
+    auto [batch_throughput, batch_latency] = batch_accumulator.Get();
     per_model->set_batch_throughput(batch_throughput);
     per_model->set_batch_average_latency_us(batch_latency);
     GenerateTensorTransferAggregatedResult(per_model);
+    aggregator.Finalize(*per_model);
   }
 
-  AggregatePerModelInferenceStats(inference_stats);
-
   // If there is no model id provided by user, create a fake "ALL" model id to
   // represent all the requests during profiling.
   // This ALL model id is mapped to index 0, which is consistent with the index
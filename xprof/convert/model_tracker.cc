@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -113,17 +114,34 @@ std::string ModelTracker::GetArchitectureType() const {
   return "Unknown";
 }
 
+bool ModelTracker::MarkOpProcessed(ProcessedOps& processed_ops,
+                                   absl::string_view op_name,
+                                   absl::string_view op_type) {
+  absl::flat_hash_set<std::string>& op_types = processed_ops[op_name];
+  if (op_types.contains(op_type)) return false;
+  op_types.emplace(op_type);
+  return true;
+}
+
 void ModelTracker::ProcessInstructionMetadata(
     const HloInstructionInterface& instr) {
+  ProcessXlaOpCategory(instr.Category());
   absl::string_view op_name = instr.Metadata().op_name();
   absl::string_view op_type = instr.Metadata().op_type();
-  ProcessOp(op_name, op_type);
+  // Many HLO instructions share the metadata of the op they were lowered from.
+  if (!MarkOpProcessed(processed_instruction_ops_, op_name, op_type)) return;
+  ProcessOpImpl(op_name, op_type);
   ProcessOpName(op_name);
-  ProcessXlaOpCategory(instr.Category());
 }
 
 void ModelTracker::ProcessOp(absl::string_view op_name,
                              absl::string_view op_type) {
+  if (!MarkOpProcessed(processed_ops_, op_name, op_type)) return;
+  ProcessOpImpl(op_name, op_type);
+}
+
+void ModelTracker::ProcessOpImpl(absl::string_view op_name,
+                                 absl::string_view op_type) {
   if (IsTfOpType(op_type) && IsTfOpName(op_name)) {
     ProcessTfOp(op_name, op_type);
   } else if (IsJaxOpNameAndType(op_name, op_type)) {
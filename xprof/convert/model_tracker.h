@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "xla/service/hlo.pb.h"
 #include "xprof/utils/hlo_module_map.h"
@@ -39,6 +41,9 @@ class ModelTracker {
     }
   }
 
+  // Classifies the op with the given name and type. Ops that were already
+  // processed are skipped, so the cost is proportional to the number of unique
+  // ops rather than the number of instructions or events.
   void ProcessOp(absl::string_view op_name, absl::string_view op_type);
   virtual void ProcessXlaOpCategory(absl::string_view op_category);
 
@@ -62,6 +67,16 @@ class ModelTracker {
  protected:
   void ProcessInstructionMetadata(const HloInstructionInterface& instr);
   void ProcessOpName(absl::string_view op_name);
+  // Map from op name to the op types processed with that name.
+  using ProcessedOps =
+      absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>;
+
+  // Returns false if the op with the given name and type is already in
+  // <processed_ops>; otherwise, records it and returns true.
+  static bool MarkOpProcessed(ProcessedOps& processed_ops,
+                              absl::string_view op_name,
+                              absl::string_view op_type);
+  void ProcessOpImpl(absl::string_view op_name, absl::string_view op_type);
   virtual void ProcessTfOp(absl::string_view op_name,
                            absl::string_view op_type);
   virtual void ProcessJaxOp(absl::string_view op_name,
@@ -89,6 +104,13 @@ class ModelTracker {
   bool has_all_reduce_op_ = false;
   bool has_barna_core_op_ = false;
   bool has_send_recv_op_ = false;
+
+ private:
+  // ProcessOp and ProcessInstructionMetadata classify an op differently (only
+  // the latter checks the op name for BERT and LAMB), so each keeps its own
+  // memo.
+  ProcessedOps processed_ops_;
+  ProcessedOps processed_instruction_ops_;
 };
 
 }  // namespace tensorflow::profiler
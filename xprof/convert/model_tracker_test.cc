@@ -0,0 +1,71 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/model_tracker.h"
+
+#include <memory>
+#include <utility>
+
+#include "<gtest/gtest.h>"
+#include "absl/strings/string_view.h"
+#include "xla/hlo/ir/hlo_module.h"
+#include "xla/hlo/parser/hlo_parser.h"
+#include "xla/tsl/platform/status_matchers.h"
+#include "xprof/utils/hlo_module_map.h"
+
+namespace tensorflow::profiler {
+namespace {
+
+constexpr absl::string_view kBertHlo = R"(
+  HloModule BertModule
+
+  ENTRY main {
+    p0 = f32[2,2]{1,0} parameter(0)
+    p1 = f32[2,2]{1,0} parameter(1)
+    dot.1 = f32[2,2]{1,0} dot(p0, p1), lhs_contracting_dims={1}, rhs_contracting_dims={0}, metadata={op_type="MatMul" op_name="bert/encoder/MatMul"}
+    ROOT add.1 = f32[2,2]{1,0} add(dot.1, p1), metadata={op_type="MatMul" op_name="bert/encoder/MatMul"}
+  }
+)";
+
+TEST(ModelTrackerTest, RepeatedOpsAreClassifiedOnce) {
+  ModelTracker model_tracker;
+  model_tracker.ProcessOp("gradients/dense/MatMul_grad/MatMul", "MatMul");
+  model_tracker.ProcessOp("gradients/dense/MatMul_grad/MatMul", "MatMul");
+  model_tracker.ProcessOp("dense/MatMul", "MatMul");
+
+  EXPECT_TRUE(model_tracker.IsTraining());
+  EXPECT_EQ(model_tracker.GetFramework(), ModelTracker::kTensorFlow1);
+}
+
+TEST(ModelTrackerTest, HloMetadataOfAProcessedOpIsStillChecked) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<xla::HloModule> hlo_module,
+                          xla::ParseAndReturnUnverifiedModule(kBertHlo));
+  HloModuleWrapper hlo_module_wrapper(std::move(hlo_module),
+                                      /*cost_analysis=*/nullptr);
+  ModelTracker model_tracker;
+  // ProcessOp does not look for BERT, so the same op seen later in the HLO
+  // metadata must not be skipped.
+  model_tracker.ProcessOp("bert/encoder/MatMul", "MatMul");
+  EXPECT_FALSE(model_tracker.HasBertTfOp());
+
+  model_tracker.ProcessHloModule(hlo_module_wrapper);
+
+  EXPECT_TRUE(model_tracker.HasBertTfOp());
+  EXPECT_FALSE(model_tracker.HasLambTfOp());
+  EXPECT_EQ(model_tracker.GetFramework(), ModelTracker::kTensorFlow);
+}
+
+}  // namespace
+}  // namespace tensorflow::profiler
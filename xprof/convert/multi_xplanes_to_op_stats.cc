@@ -15,19 +15,26 @@ limitations under the License.
 
 #include "xprof/convert/multi_xplanes_to_op_stats.h"
 
+#include <cstdint>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/arena.h"
 #include "xla/tsl/platform/errors.h"
 #include "xla/tsl/platform/statusor.h"
 #include "xla/tsl/platform/types.h"
 #include "tsl/profiler/protobuf/xplane.pb.h"
+#include "xprof/convert/compute_inference_latency.h"
+#include "xprof/convert/multi_xspace_to_inference_stats.h"
 #include "xprof/convert/op_stats_combiner.h"
 #include "xprof/convert/preprocess_single_host_xplane.h"
 #include "xprof/convert/repository.h"
 #include "xprof/convert/xplane_to_op_stats.h"
+#include "plugin/xprof/protobuf/inference_stats.pb.h"
 #include "plugin/xprof/protobuf/op_stats.pb.h"
 #include "xprof/utils/hardware_type_utils.h"
 #include "xprof/utils/step_intersection.h"
@@ -94,5 +101,50 @@ absl::Status ConvertMultiXSpaceToCombinedOpStatsWithCache(
   return absl::OkStatus();
 }
 
+absl::Status ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+    const SessionSnapshot& session_snapshot, uint64_t slice_duration_ps,
+    OpStats* op_stats) {
+  // Each slice duration gets its own cache file next to the combined OpStats.
+  std::string host =
+      absl::StrCat(kAllHostsIdentifier, ".slice_", slice_duration_ps, "ps");
+  TF_ASSIGN_OR_RETURN(
+      std::optional<std::string> cache_path,
+      session_snapshot.GetHostDataFilePath(StoredDataType::OP_STATS, host));
+  if (cache_path.has_value()) {
+    return ReadBinaryProto(session_snapshot, StoredDataType::OP_STATS, host,
+                           op_stats);
+  }
+  OpStatsOptions options;
+  options.generate_op_metrics_db = true;
+  options.op_metrics_db_slice_duration_ps = slice_duration_ps;
+  TF_RETURN_IF_ERROR(ConvertMultiXSpacesToCombinedOpStats(session_snapshot,
+                                                          options, op_stats));
+  if (!WriteBinaryProto(session_snapshot, StoredDataType::OP_STATS, host,
+                        *op_stats)
+           .ok()) {
+    LOG(WARNING) << "Failed to write time-sliced op stats cache file.";
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AddInferenceLatencyWithCache(
+    const SessionSnapshot& session_snapshot, OpStats* combined_op_stats) {
+  if (combined_op_stats->has_inference_latency() ||
+      combined_op_stats->run_environment().is_training()) {
+    return absl::OkStatus();
+  }
+  InferenceStats inference_stats;
+  TF_RETURN_IF_ERROR(ConvertMultiXSpaceToInferenceStats(
+      session_snapshot, "", "", &inference_stats));
+  *combined_op_stats->mutable_inference_latency() =
+      ComputeInferenceLatencyResult(inference_stats);
+  if (!WriteBinaryProto(session_snapshot, StoredDataType::OP_STATS,
+                        kAllHostsIdentifier, *combined_op_stats)
+           .ok()) {
+    LOG(WARNING) << "Failed to write op stats cache file.";
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace profiler
 }  // namespace tensorflow
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef XPROF_CONVERT_MULTI_XPLANES_TO_OP_STATS_H_
 #define XPROF_CONVERT_MULTI_XPLANES_TO_OP_STATS_H_
 
+#include <cstdint>
+
 #include "absl/status/status.h"
 #include "xprof/convert/repository.h"
 #include "xprof/convert/xplane_to_op_stats.h"
@@ -36,6 +38,20 @@ absl::Status ConvertMultiXSpacesToCombinedOpStats(
 absl::Status ConvertMultiXSpaceToCombinedOpStatsWithCache(
     const SessionSnapshot& session_snapshot, OpStats* combined_op_stats);
 
+// Converts multiple XSpaces to an OpStats whose device op metrics are split
+// into time slices of <slice_duration_ps>, using a cache file per slice
+// duration if available.
+absl::Status ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+    const SessionSnapshot& session_snapshot, uint64_t slice_duration_ps,
+    OpStats* op_stats);
+
+// Computes the inference latency of an inference profile and stores it in
+// <combined_op_stats> and in the OpStats cache, so that the extra pass over the
+// XSpaces runs once per session. Does nothing for training profiles or if the
+// latency is already there.
+absl::Status AddInferenceLatencyWithCache(
+    const SessionSnapshot& session_snapshot, OpStats* combined_op_stats);
+
 }  // namespace profiler
 }  // namespace tensorflow
 
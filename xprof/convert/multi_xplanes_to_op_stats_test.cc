@@ -0,0 +1,122 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/multi_xplanes_to_op_stats.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "<gtest/gtest.h>"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "xla/tsl/platform/status.h"
+#include "xla/tsl/platform/status_matchers.h"
+#include "xla/tsl/platform/statusor.h"
+#include "xla/tsl/profiler/utils/xplane_utils.h"
+#include "tsl/profiler/protobuf/xplane.pb.h"
+#include "xprof/convert/repository.h"
+#include "plugin/xprof/protobuf/op_stats.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+SessionSnapshot CreateSessionSnapshot() {
+  std::string test_name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->name();
+  std::string path = absl::StrCat("ram://", test_name, "/");
+  std::vector<std::string> paths = {absl::StrCat(path, "hostname.xplane.pb")};
+
+  auto xspace = std::make_unique<XSpace>();
+  tsl::profiler::FindOrAddMutablePlaneWithName(xspace.get(), "/host:CPU");
+  std::vector<std::unique_ptr<XSpace>> xspaces;
+  xspaces.push_back(std::move(xspace));
+
+  absl::StatusOr<SessionSnapshot> session_snapshot =
+      SessionSnapshot::Create(paths, std::move(xspaces));
+  TF_CHECK_OK(session_snapshot.status());
+  return std::move(session_snapshot).value();
+}
+
+TEST(MultiXPlanesToOpStatsTest, CombinedOpStatsHaveNoInferenceLatency) {
+  SessionSnapshot session_snapshot = CreateSessionSnapshot();
+  OpStats combined_op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      session_snapshot, &combined_op_stats));
+
+  ASSERT_FALSE(combined_op_stats.run_environment().is_training());
+  EXPECT_FALSE(combined_op_stats.has_inference_latency());
+}
+
+TEST(MultiXPlanesToOpStatsTest, InferenceLatencyIsAddedToTheCache) {
+  SessionSnapshot session_snapshot = CreateSessionSnapshot();
+  OpStats combined_op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      session_snapshot, &combined_op_stats));
+
+  TF_ASSERT_OK(
+      AddInferenceLatencyWithCache(session_snapshot, &combined_op_stats));
+  EXPECT_TRUE(combined_op_stats.has_inference_latency());
+
+  OpStats cached_op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      session_snapshot, &cached_op_stats));
+  EXPECT_TRUE(cached_op_stats.has_inference_latency());
+}
+
+TEST(MultiXPlanesToOpStatsTest, TrainingProfileHasNoInferenceLatency) {
+  SessionSnapshot session_snapshot = CreateSessionSnapshot();
+  OpStats combined_op_stats;
+  combined_op_stats.mutable_run_environment()->set_is_training(true);
+
+  TF_ASSERT_OK(
+      AddInferenceLatencyWithCache(session_snapshot, &combined_op_stats));
+  EXPECT_FALSE(combined_op_stats.has_inference_latency());
+}
+
+TEST(MultiXPlanesToOpStatsTest, TimeSlicedOpStatsAreCachedPerSliceDuration) {
+  SessionSnapshot session_snapshot = CreateSessionSnapshot();
+  OpStats op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+      session_snapshot, /*slice_duration_ps=*/1000, &op_stats));
+
+  // The combined OpStats cache is left alone.
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto has_cache, session_snapshot.HasCacheFile(StoredDataType::OP_STATS));
+  EXPECT_FALSE(has_cache.first);
+
+  // A second request with the same slice duration reads the cache file.
+  OpStats marker;
+  marker.mutable_run_environment()->set_host_count(42);
+  TF_ASSERT_OK(WriteBinaryProto(
+      session_snapshot, StoredDataType::OP_STATS,
+      absl::StrCat(kAllHostsIdentifier, ".slice_1000ps"), marker));
+  OpStats cached_op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+      session_snapshot, /*slice_duration_ps=*/1000, &cached_op_stats));
+  EXPECT_EQ(cached_op_stats.run_environment().host_count(), 42);
+
+  // Another slice duration does not share it.
+  OpStats other_op_stats;
+  TF_ASSERT_OK(ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+      session_snapshot, /*slice_duration_ps=*/2000, &other_op_stats));
+  EXPECT_NE(other_op_stats.run_environment().host_count(), 42);
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -16,6 +16,8 @@ limitations under the License.
 #include "xprof/convert/op_metrics_db_combiner.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
@@ -144,5 +146,75 @@ void OpMetricsDbCombiner::Combine(const OpMetricsDb& src,
   }
 }
 
+class TimeSlicedOpMetricsDbBuilder::Slice : public OpMetricsDbBuilder {
+ public:
+  Slice() : OpMetricsDbBuilder(&db_) {}
+
+  void Add(const OpMetrics& src) {
+    OpMetrics* dst =
+        LookupOrInsertNewOpMetrics(src.hlo_module_id(), src.name());
+    if (dst->category().empty()) {
+      dst->set_category(src.category());
+    }
+    dst->set_occurrences(src.occurrences() + dst->occurrences());
+    dst->set_time_ps(src.time_ps() + dst->time_ps());
+    dst->set_self_time_ps(src.self_time_ps() + dst->self_time_ps());
+    dst->set_flops(src.flops() + dst->flops());
+    dst->set_model_flops(src.model_flops() + dst->model_flops());
+    dst->set_bytes_accessed(src.bytes_accessed() + dst->bytes_accessed());
+    db_.set_total_op_time_ps(src.self_time_ps() + db_.total_op_time_ps());
+  }
+
+  OpMetricsDb& db() { return db_; }
+
+ private:
+  OpMetricsDb db_;
+};
+
+TimeSlicedOpMetricsDbBuilder::TimeSlicedOpMetricsDbBuilder(
+    uint64_t slice_duration_ps)
+    : slice_duration_ps_(slice_duration_ps) {
+  DCHECK_GT(slice_duration_ps_, 0);
+}
+
+TimeSlicedOpMetricsDbBuilder::~TimeSlicedOpMetricsDbBuilder() = default;
+
+TimeSlicedOpMetricsDbBuilder::Slice& TimeSlicedOpMetricsDbBuilder::GetSlice(
+    uint64_t begin_ps) {
+  std::unique_ptr<Slice>& slice = slices_[begin_ps / slice_duration_ps_];
+  if (slice == nullptr) slice = std::make_unique<Slice>();
+  return *slice;
+}
+
+void TimeSlicedOpMetricsDbBuilder::AddOpMetrics(uint64_t begin_ps,
+                                                const OpMetrics& op_metrics) {
+  GetSlice(begin_ps).Add(op_metrics);
+}
+
+void TimeSlicedOpMetricsDbBuilder::Combine(const TimeSlicedOpMetricsDb& src) {
+  DCHECK_EQ(src.slice_duration_ps(), slice_duration_ps_);
+  for (const OpMetricsDbSlice& src_slice : src.slices()) {
+    Slice& dst_slice = GetSlice(src_slice.begin_ps());
+    for (const OpMetrics& src_metrics :
+         src_slice.op_metrics_db().metrics_db()) {
+      dst_slice.Add(src_metrics);
+    }
+  }
+}
+
+TimeSlicedOpMetricsDb TimeSlicedOpMetricsDbBuilder::Finalize() {
+  TimeSlicedOpMetricsDb result;
+  result.set_slice_duration_ps(slice_duration_ps_);
+  result.mutable_slices()->Reserve(slices_.size());
+  for (auto& [index, slice] : slices_) {
+    OpMetricsDbSlice* dst = result.add_slices();
+    dst->set_begin_ps(index * slice_duration_ps_);
+    slice->db().set_total_time_ps(slice_duration_ps_);
+    *dst->mutable_op_metrics_db() = std::move(slice->db());
+  }
+  slices_.clear();
+  return result;
+}
+
 }  // namespace profiler
 }  // namespace tensorflow
@@ -16,6 +16,10 @@ limitations under the License.
 #ifndef XPROF_CONVERT_OP_METRICS_DB_COMBINER_H_
 #define XPROF_CONVERT_OP_METRICS_DB_COMBINER_H_
 
+#include <cstdint>
+#include <memory>
+
+#include "absl/container/btree_map.h"
 #include "tsl/platform/protobuf.h"
 #include "plugin/xprof/protobuf/op_metrics.pb.h"
 #include "xprof/utils/op_metrics_db_utils.h"
@@ -48,6 +52,35 @@ class OpMetricsDbCombiner : public OpMetricsDbBuilder {
   void Combine(const OpMetricsDb& src, bool update_num_cores = true);
 };
 
+// Helper to bucket op metrics into fixed-duration time slices. An op is
+// attributed to the slice in which it begins. Each slice keeps only the
+// fields that vary over time (occurrences, times, flops and bytes accessed);
+// metadata stays in the session-wide OpMetricsDb.
+class TimeSlicedOpMetricsDbBuilder {
+ public:
+  // REQUIRED: slice_duration_ps > 0.
+  explicit TimeSlicedOpMetricsDbBuilder(uint64_t slice_duration_ps);
+  ~TimeSlicedOpMetricsDbBuilder();
+
+  // Adds <op_metrics> of an op that began at <begin_ps>.
+  void AddOpMetrics(uint64_t begin_ps, const OpMetrics& op_metrics);
+
+  // Combines the slices in <src>, which must have the same slice duration.
+  void Combine(const TimeSlicedOpMetricsDb& src);
+
+  // Moves the non-empty slices, ordered by begin time, into a
+  // TimeSlicedOpMetricsDb.
+  TimeSlicedOpMetricsDb Finalize();
+
+ private:
+  class Slice;
+
+  Slice& GetSlice(uint64_t begin_ps);
+
+  uint64_t slice_duration_ps_;
+  absl::btree_map<uint64_t /*slice index*/, std::unique_ptr<Slice>> slices_;
+};
+
 }  // namespace profiler
 }  // namespace tensorflow
 
@@ -0,0 +1,717 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/op_metrics_db_query.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "xla/tsl/platform/errors.h"
+#include "xla/tsl/platform/statusor.h"
+#include "xprof/convert/data_table_utils.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+using Comparison = OpMetricsQuery::Comparison;
+using Function = OpMetricsQuery::Function;
+
+struct NumericColumnSpec {
+  absl::string_view name;
+  uint64_t (*value)(const OpMetrics&);
+  // Identifiers (e.g. fingerprints) are returned as text, since a DataTable
+  // number cannot hold all 64-bit values.
+  bool is_id = false;
+};
+
+const NumericColumnSpec kNumericColumns[] = {
+    {"hlo_module_id", [](const OpMetrics& m) { return m.hlo_module_id(); },
+     /*is_id=*/true},
+    {"occurrences",
+     [](const OpMetrics& m) -> uint64_t { return m.occurrences(); }},
+    {"time_ps", [](const OpMetrics& m) { return m.time_ps(); }},
+    {"self_time_ps", [](const OpMetrics& m) { return m.self_time_ps(); }},
+    {"min_time_ps", [](const OpMetrics& m) { return m.min_time_ps(); }},
+    {"flops", [](const OpMetrics& m) { return m.flops(); }},
+    {"model_flops", [](const OpMetrics& m) { return m.model_flops(); }},
+    {"bytes_accessed", [](const OpMetrics& m) { return m.bytes_accessed(); }},
+    {"dma_stall_ps", [](const OpMetrics& m) { return m.dma_stall_ps(); }},
+};
+
+struct TextColumnSpec {
+  absl::string_view name;
+  const std::string& (*value)(const OpMetrics&);
+};
+
+const TextColumnSpec kTextColumns[] = {
+    {"name", [](const OpMetrics& m) -> const std::string& { return m.name(); }},
+    {"long_name",
+     [](const OpMetrics& m) -> const std::string& { return m.long_name(); }},
+    {"category",
+     [](const OpMetrics& m) -> const std::string& { return m.category(); }},
+    {"provenance",
+     [](const OpMetrics& m) -> const std::string& { return m.provenance(); }},
+    {"deduplicated_name",
+     [](const OpMetrics& m) -> const std::string& {
+       return m.deduplicated_name();
+     }},
+};
+
+// Columns returned for the ops of a query without aggregation.
+constexpr absl::string_view kDefaultOpColumns[] = {
+    "name",    "category",     "hlo_module_id", "occurrences",
+    "time_ps", "self_time_ps", "flops",         "bytes_accessed",
+};
+
+constexpr char kDefaultOrderBy[] = "self_time_ps";
+constexpr char kDefaultAggregateOrderBy[] = "sum(self_time_ps)";
+
+struct ColumnRef {
+  bool is_text;
+  size_t index;
+};
+
+std::optional<ColumnRef> FindColumn(absl::string_view name) {
+  for (size_t i = 0; i < std::size(kNumericColumns); ++i) {
+    if (kNumericColumns[i].name == name) return ColumnRef{false, i};
+  }
+  for (size_t i = 0; i < std::size(kTextColumns); ++i) {
+    if (kTextColumns[i].name == name) return ColumnRef{true, i};
+  }
+  return std::nullopt;
+}
+
+absl::StatusOr<ColumnRef> GetColumn(absl::string_view name) {
+  std::optional<ColumnRef> column = FindColumn(name);
+  if (!column) {
+    return tsl::errors::InvalidArgument("Unknown op metrics column: ", name);
+  }
+  return *column;
+}
+
+absl::string_view FunctionName(Function function) {
+  switch (function) {
+    case Function::kCount:
+      return "count";
+    case Function::kSum:
+      return "sum";
+    case Function::kAvg:
+      return "avg";
+    case Function::kMin:
+      return "min";
+    case Function::kMax:
+      return "max";
+  }
+  return "";
+}
+
+struct Token {
+  std::string text;
+  bool quoted = false;
+};
+
+bool IsOperatorChar(char c) { return absl::StrContains("=!<>~", c); }
+
+bool IsPunctuation(char c) { return c == '(' || c == ')' || c == ','; }
+
+// Splits a query stage into words, quoted strings, comparison operators and
+// the punctuation '(', ')' and ','.
+absl::StatusOr<std::vector<Token>> Tokenize(absl::string_view stage) {
+  std::vector<Token> tokens;
+  size_t i = 0;
+  while (i < stage.size()) {
+    char c = stage[i];
+    if (absl::ascii_isspace(c)) {
+      ++i;
+    } else if (c == '"' || c == '\'') {
+      size_t end = stage.find(c, i + 1);
+      if (end == absl::string_view::npos) {
+        return tsl::errors::InvalidArgument("Unterminated string in query: ",
+                                            stage);
+      }
+      tokens.push_back({std::string(stage.substr(i + 1, end - i - 1)), true});
+      i = end + 1;
+    } else if (IsPunctuation(c)) {
+      tokens.push_back({std::string(1, c)});
+      ++i;
+    } else {
+      size_t end = i;
+      bool is_operator = IsOperatorChar(c);
+      while (end < stage.size() && !absl::ascii_isspace(stage[end]) &&
+             !IsPunctuation(stage[end]) && stage[end] != '"' &&
+             stage[end] != '\'' && IsOperatorChar(stage[end]) == is_operator) {
+        ++end;
+      }
+      tokens.push_back({std::string(stage.substr(i, end - i))});
+      i = end;
+    }
+  }
+  return tokens;
+}
+
+// Consumes the tokens of one query stage.
+class StageParser {
+ public:
+  explicit StageParser(std::vector<Token> tokens)
+      : tokens_(std::move(tokens)) {}
+
+  bool AtEnd() const { return pos_ == tokens_.size(); }
+
+  // Consumes the next token if it is the unquoted `text`.
+  bool Consume(absl::string_view text) {
+    if (AtEnd() || tokens_[pos_].quoted || tokens_[pos_].text != text) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+
+  absl::StatusOr<Token> Next() {
+    if (AtEnd()) {
+      return tsl::errors::InvalidArgument("Unexpected end of query stage.");
+    }
+    return tokens_[pos_++];
+  }
+
+  absl::StatusOr<std::string> Word() {
+    TF_ASSIGN_OR_RETURN(Token token, Next());
+    if (token.quoted ||
+        (token.text.size() == 1 && IsPunctuation(token.text[0]))) {
+      return tsl::errors::InvalidArgument("Expected a name but got: ",
+                                          token.text);
+    }
+    return token.text;
+  }
+
+  absl::Status Expect(absl::string_view text) {
+    if (!Consume(text)) {
+      return tsl::errors::InvalidArgument("Expected '", text, "' in query.");
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status ExpectEnd() {
+    if (!AtEnd()) {
+      return tsl::errors::InvalidArgument("Unexpected token in query: ",
+                                          tokens_[pos_].text);
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  std::vector<Token> tokens_;
+  size_t pos_ = 0;
+};
+
+absl::StatusOr<Comparison> ParseComparison(absl::string_view text) {
+  if (text == "==" || text == "=") return Comparison::kEq;
+  if (text == "!=") return Comparison::kNe;
+  if (text == "<") return Comparison::kLt;
+  if (text == "<=") return Comparison::kLe;
+  if (text == ">") return Comparison::kGt;
+  if (text == ">=") return Comparison::kGe;
+  if (text == "~") return Comparison::kContains;
+  return tsl::errors::InvalidArgument("Unknown comparison: ", text);
+}
+
+absl::StatusOr<OpMetricsQuery::Predicate> ParsePredicate(StageParser& parser) {
+  OpMetricsQuery::Predicate predicate;
+  TF_ASSIGN_OR_RETURN(predicate.column, parser.Word());
+  TF_ASSIGN_OR_RETURN(ColumnRef column, GetColumn(predicate.column));
+  TF_ASSIGN_OR_RETURN(std::string comparison, parser.Word());
+  TF_ASSIGN_OR_RETURN(predicate.comparison, ParseComparison(comparison));
+  TF_ASSIGN_OR_RETURN(Token value, parser.Next());
+  predicate.text = value.text;
+  if (column.is_text) {
+    if (predicate.comparison != Comparison::kEq &&
+        predicate.comparison != Comparison::kNe &&
+        predicate.comparison != Comparison::kContains) {
+      return tsl::errors::InvalidArgument("Text column ", predicate.column,
+                                          " only supports ==, != and ~.");
+    }
+  } else if (predicate.comparison == Comparison::kContains ||
+             !absl::SimpleAtod(value.text, &predicate.number)) {
+    return tsl::errors::InvalidArgument("Numeric column ", predicate.column,
+                                        " must be compared to a number.");
+  }
+  uint64_t integer;
+  if (!column.is_text && absl::SimpleAtoi(value.text, &integer)) {
+    predicate.integer = integer;
+  }
+  return predicate;
+}
+
+absl::StatusOr<OpMetricsQuery::Aggregate> ParseAggregate(StageParser& parser) {
+  OpMetricsQuery::Aggregate aggregate;
+  TF_ASSIGN_OR_RETURN(std::string function, parser.Word());
+  if (function == "count") {
+    aggregate.function = Function::kCount;
+  } else if (function == "sum") {
+    aggregate.function = Function::kSum;
+  } else if (function == "avg") {
+    aggregate.function = Function::kAvg;
+  } else if (function == "min") {
+    aggregate.function = Function::kMin;
+  } else if (function == "max") {
+    aggregate.function = Function::kMax;
+  } else {
+    return tsl::errors::InvalidArgument("Unknown aggregate: ", function);
+  }
+  TF_RETURN_IF_ERROR(parser.Expect("("));
+  if (aggregate.function == Function::kCount) {
+    parser.Consume("*");
+  } else {
+    TF_ASSIGN_OR_RETURN(aggregate.column, parser.Word());
+    TF_ASSIGN_OR_RETURN(ColumnRef column, GetColumn(aggregate.column));
+    if (column.is_text) {
+      return tsl::errors::InvalidArgument("Cannot aggregate text column ",
+                                          aggregate.column);
+    }
+  }
+  TF_RETURN_IF_ERROR(parser.Expect(")"));
+  return aggregate;
+}
+
+absl::Status ParseStage(absl::string_view stage, OpMetricsQuery& query) {
+  TF_ASSIGN_OR_RETURN(std::vector<Token> tokens, Tokenize(stage));
+  StageParser parser(std::move(tokens));
+  TF_ASSIGN_OR_RETURN(std::string keyword, parser.Word());
+  if (keyword == "filter") {
+    do {
+      TF_ASSIGN_OR_RETURN(OpMetricsQuery::Predicate predicate,
+                          ParsePredicate(parser));
+      query.filters.push_back(std::move(predicate));
+    } while (parser.Consume("and"));
+  } else if (keyword == "group") {
+    do {
+      TF_ASSIGN_OR_RETURN(std::string column, parser.Word());
+      TF_RETURN_IF_ERROR(GetColumn(column).status());
+      query.group_by.push_back(std::move(column));
+    } while (parser.Consume(","));
+  } else if (keyword == "agg") {
+    do {
+      TF_ASSIGN_OR_RETURN(OpMetricsQuery::Aggregate aggregate,
+                          ParseAggregate(parser));
+      query.aggregates.push_back(std::move(aggregate));
+    } while (parser.Consume(","));
+  } else if (keyword == "top") {
+    TF_ASSIGN_OR_RETURN(std::string k, parser.Word());
+    size_t top_k;
+    if (!absl::SimpleAtoi(k, &top_k)) {
+      return tsl::errors::InvalidArgument("Invalid top count: ", k);
+    }
+    query.top_k = top_k;
+    if (parser.Consume("by")) {
+      TF_ASSIGN_OR_RETURN(query.order_by, parser.Word());
+      // Aggregates are referred to by their output name, e.g. sum(time_ps).
+      if (parser.Consume("(")) {
+        absl::StrAppend(&query.order_by, "(");
+        if (!parser.Consume(")")) {
+          if (!parser.Consume("*")) {
+            TF_ASSIGN_OR_RETURN(std::string column, parser.Word());
+            absl::StrAppend(&query.order_by, column);
+          }
+          TF_RETURN_IF_ERROR(parser.Expect(")"));
+        }
+        absl::StrAppend(&query.order_by, ")");
+      }
+    }
+  } else {
+    return tsl::errors::InvalidArgument("Unknown query stage: ", keyword);
+  }
+  return parser.ExpectEnd();
+}
+
+// Lazily built columnar view of the top-level ops of an OpMetricsDb. Text
+// columns are dictionary encoded so that filters and group keys compare codes
+// instead of strings. Each column has a fixed slot, so references to built
+// columns stay valid while other columns are built.
+class OpMetricsColumns {
+ public:
+  struct Dictionary {
+    std::vector<uint32_t> codes;
+    std::vector<absl::string_view> values;
+  };
+
+  explicit OpMetricsColumns(const OpMetricsDb& db) : db_(db) {}
+
+  size_t NumRows() const { return db_.metrics_db_size(); }
+
+  const std::vector<uint64_t>& Numeric(size_t index) {
+    std::optional<std::vector<uint64_t>>& column = numeric_[index];
+    if (!column) {
+      column.emplace();
+      column->reserve(NumRows());
+      for (const OpMetrics& metrics : db_.metrics_db()) {
+        column->push_back(kNumericColumns[index].value(metrics));
+      }
+    }
+    return *column;
+  }
+
+  const Dictionary& Text(size_t index) {
+    std::optional<Dictionary>& column = text_[index];
+    if (!column) {
+      Dictionary& dictionary = column.emplace();
+      dictionary.codes.reserve(NumRows());
+      absl::flat_hash_map<absl::string_view, uint32_t> code_by_value;
+      for (const OpMetrics& metrics : db_.metrics_db()) {
+        absl::string_view value = kTextColumns[index].value(metrics);
+        auto [code, new_value] =
+            code_by_value.try_emplace(value, dictionary.values.size());
+        if (new_value) dictionary.values.push_back(value);
+        dictionary.codes.push_back(code->second);
+      }
+    }
+    return *column;
+  }
+
+  // Returns the value of a column as an exact key; text columns return the
+  // code.
+  uint64_t Key(const ColumnRef& column, uint32_t row) {
+    return column.is_text ? Text(column.index).codes[row]
+                          : Numeric(column.index)[row];
+  }
+
+ private:
+  const OpMetricsDb& db_;
+  std::array<std::optional<std::vector<uint64_t>>, std::size(kNumericColumns)>
+      numeric_;
+  std::array<std::optional<Dictionary>, std::size(kTextColumns)> text_;
+};
+
+template <typename T>
+bool Compare(T value, T other, Comparison comparison) {
+  switch (comparison) {
+    case Comparison::kEq:
+      return value == other;
+    case Comparison::kNe:
+      return value != other;
+    case Comparison::kLt:
+      return value < other;
+    case Comparison::kLe:
+      return value <= other;
+    case Comparison::kGt:
+      return value > other;
+    case Comparison::kGe:
+      return value >= other;
+    case Comparison::kContains:
+      return false;
+  }
+  return false;
+}
+
+bool Compare(uint64_t value, const OpMetricsQuery::Predicate& predicate) {
+  if (predicate.integer) {
+    return Compare(value, *predicate.integer, predicate.comparison);
+  }
+  return Compare(static_cast<double>(value), predicate.number,
+                 predicate.comparison);
+}
+
+bool Compare(absl::string_view value,
+             const OpMetricsQuery::Predicate& predicate) {
+  switch (predicate.comparison) {
+    case Comparison::kEq:
+      return value == predicate.text;
+    case Comparison::kNe:
+      return value != predicate.text;
+    case Comparison::kContains:
+      return absl::StrContains(value, predicate.text);
+    default:
+      return false;
+  }
+}
+
+std::vector<uint32_t> Filter(
+    const std::vector<OpMetricsQuery::Predicate>& filters,
+    OpMetricsColumns& columns) {
+  std::vector<uint32_t> rows(columns.NumRows());
+  std::iota(rows.begin(), rows.end(), 0);
+  for (const OpMetricsQuery::Predicate& predicate : filters) {
+    ColumnRef column = *FindColumn(predicate.column);
+    if (column.is_text) {
+      // Evaluate the predicate once per distinct value.
+      const OpMetricsColumns::Dictionary& dictionary =
+          columns.Text(column.index);
+      std::vector<bool> matches;
+      matches.reserve(dictionary.values.size());
+      for (absl::string_view value : dictionary.values) {
+        matches.push_back(Compare(value, predicate));
+      }
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                [&](uint32_t row) {
+                                  return !matches[dictionary.codes[row]];
+                                }),
+                 rows.end());
+    } else {
+      const std::vector<uint64_t>& values = columns.Numeric(column.index);
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                [&](uint32_t row) {
+                                  return !Compare(values[row], predicate);
+                                }),
+                 rows.end());
+    }
+  }
+  return rows;
+}
+
+// A result column holds text, identifiers (written as text) or numbers.
+struct ResultColumn {
+  std::string name;
+  bool is_text = false;
+  bool is_id = false;
+  std::vector<absl::string_view> text;
+  std::vector<uint64_t> ids;
+  std::vector<double> numbers;
+};
+
+void InitResultColumn(absl::string_view name, const ColumnRef& column,
+                      ResultColumn& result) {
+  result.name = std::string(name);
+  result.is_text = column.is_text;
+  result.is_id = !column.is_text && kNumericColumns[column.index].is_id;
+}
+
+void AppendValue(const ColumnRef& column, uint32_t row,
+                 OpMetricsColumns& columns, ResultColumn& result) {
+  if (column.is_text) {
+    const OpMetricsColumns::Dictionary& dictionary = columns.Text(column.index);
+    result.text.push_back(dictionary.values[dictionary.codes[row]]);
+  } else if (result.is_id) {
+    result.ids.push_back(columns.Numeric(column.index)[row]);
+  } else {
+    result.numbers.push_back(columns.Numeric(column.index)[row]);
+  }
+}
+
+size_t NumResultRows(const ResultColumn& column) {
+  if (column.is_text) return column.text.size();
+  if (column.is_id) return column.ids.size();
+  return column.numbers.size();
+}
+
+class Accumulator {
+ public:
+  void Add(uint64_t value) {
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  double Result(Function function) const {
+    switch (function) {
+      case Function::kCount:
+        return count_;
+      case Function::kSum:
+        return sum_;
+      case Function::kAvg:
+        return count_ ? sum_ / count_ : 0.0;
+      case Function::kMin:
+        return count_ ? min_ : 0.0;
+      case Function::kMax:
+        return count_ ? max_ : 0.0;
+    }
+    return 0.0;
+  }
+
+ private:
+  uint64_t count_ = 0;
+  double sum_ = 0.0;
+  uint64_t min_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_ = 0;
+};
+
+std::vector<ResultColumn> Aggregate(const OpMetricsQuery& query,
+                                    const std::vector<uint32_t>& rows,
+                                    OpMetricsColumns& columns) {
+  std::vector<OpMetricsQuery::Aggregate> aggregates = query.aggregates;
+  if (aggregates.empty()) {
+    aggregates = {{Function::kCount, ""}, {Function::kSum, "self_time_ps"}};
+  }
+  std::vector<ColumnRef> group_columns;
+  for (const std::string& name : query.group_by) {
+    group_columns.push_back(*FindColumn(name));
+  }
+  std::vector<const std::vector<uint64_t>*> aggregated_values;
+  for (const OpMetricsQuery::Aggregate& aggregate : aggregates) {
+    aggregated_values.push_back(
+        aggregate.function == Function::kCount
+            ? nullptr
+            : &columns.Numeric(FindColumn(aggregate.column)->index));
+  }
+
+  // Without group columns all rows fall in a single group, which exists even
+  // if no row passed the filters.
+  absl::flat_hash_map<std::vector<uint64_t>, size_t> group_by_key;
+  std::vector<uint32_t> first_rows;
+  std::vector<std::vector<Accumulator>> accumulators;
+  if (group_columns.empty()) {
+    group_by_key.try_emplace(std::vector<uint64_t>(), 0);
+    first_rows.push_back(0);
+    accumulators.emplace_back(aggregates.size());
+  }
+  std::vector<uint64_t> key(group_columns.size());
+  for (uint32_t row : rows) {
+    for (size_t i = 0; i < group_columns.size(); ++i) {
+      key[i] = columns.Key(group_columns[i], row);
+    }
+    auto [it, inserted] = group_by_key.try_emplace(key, first_rows.size());
+    if (inserted) {
+      first_rows.push_back(row);
+      accumulators.emplace_back(aggregates.size());
+    }
+    std::vector<Accumulator>& group = accumulators[it->second];
+    for (size_t i = 0; i < aggregates.size(); ++i) {
+      group[i].Add(aggregated_values[i] ? (*aggregated_values[i])[row] : 0);
+    }
+  }
+
+  std::vector<ResultColumn> result;
+  for (size_t i = 0; i < group_columns.size(); ++i) {
+    ResultColumn& column = result.emplace_back();
+    InitResultColumn(query.group_by[i], group_columns[i], column);
+    for (uint32_t row : first_rows) {
+      AppendValue(group_columns[i], row, columns, column);
+    }
+  }
+  for (size_t i = 0; i < aggregates.size(); ++i) {
+    ResultColumn& column = result.emplace_back();
+    column.name = aggregates[i].OutputName();
+    for (const std::vector<Accumulator>& group : accumulators) {
+      column.numbers.push_back(group[i].Result(aggregates[i].function));
+    }
+  }
+  return result;
+}
+
+std::vector<ResultColumn> Project(const std::vector<uint32_t>& rows,
+                                  OpMetricsColumns& columns) {
+  std::vector<ResultColumn> result;
+  for (absl::string_view name : kDefaultOpColumns) {
+    ColumnRef column_ref = *FindColumn(name);
+    ResultColumn& column = result.emplace_back();
+    InitResultColumn(name, column_ref, column);
+    for (uint32_t row : rows) {
+      AppendValue(column_ref, row, columns, column);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+std::string OpMetricsQuery::Aggregate::OutputName() const {
+  return absl::StrCat(FunctionName(function), "(", column, ")");
+}
+
+absl::StatusOr<OpMetricsQuery> ParseOpMetricsQuery(absl::string_view query) {
+  OpMetricsQuery result;
+  for (absl::string_view stage :
+       absl::StrSplit(query, '|', absl::SkipWhitespace())) {
+    TF_RETURN_IF_ERROR(ParseStage(stage, result));
+  }
+  return result;
+}
+
+absl::StatusOr<std::unique_ptr<DataTable>> RunOpMetricsQuery(
+    const OpMetricsDb& db, const OpMetricsQuery& query) {
+  OpMetricsColumns columns(db);
+  std::vector<uint32_t> rows = Filter(query.filters, columns);
+  bool aggregated = !query.group_by.empty() || !query.aggregates.empty();
+  std::vector<ResultColumn> result =
+      aggregated ? Aggregate(query, rows, columns) : Project(rows, columns);
+  size_t num_rows = NumResultRows(result.back());
+
+  std::string order_by = query.order_by;
+  if (order_by.empty()) {
+    if (!query.aggregates.empty()) {
+      order_by = query.aggregates[0].OutputName();
+    } else {
+      order_by = aggregated ? kDefaultAggregateOrderBy : kDefaultOrderBy;
+    }
+  }
+  auto order_column =
+      std::find_if(result.begin(), result.end(),
+                   [&](const ResultColumn& c) { return c.name == order_by; });
+  if (order_column == result.end()) {
+    return tsl::errors::InvalidArgument("Cannot order by ", order_by,
+                                        ", it is not a result column.");
+  }
+
+  // Numbers are sorted in decreasing and text and ids in increasing order.
+  std::vector<size_t> order(num_rows);
+  std::iota(order.begin(), order.end(), 0);
+  auto less = [&](size_t a, size_t b) {
+    if (order_column->is_text) {
+      const auto& text = order_column->text;
+      return text[a] != text[b] ? text[a] < text[b] : a < b;
+    }
+    if (order_column->is_id) {
+      const auto& ids = order_column->ids;
+      return ids[a] != ids[b] ? ids[a] < ids[b] : a < b;
+    }
+    const auto& numbers = order_column->numbers;
+    return numbers[a] != numbers[b] ? numbers[a] > numbers[b] : a < b;
+  };
+  size_t limit = std::min(num_rows, query.top_k.value_or(num_rows));
+  std::partial_sort(order.begin(), order.begin() + limit, order.end(), less);
+  order.resize(limit);
+
+  auto data_table = std::make_unique<DataTable>();
+  for (const ResultColumn& column : result) {
+    bool is_string = column.is_text || column.is_id;
+    data_table->AddColumn(TableColumn(
+        column.name, is_string ? "string" : "number", column.name));
+  }
+  for (size_t row : order) {
+    TableRow* table_row = data_table->AddRow();
+    for (const ResultColumn& column : result) {
+      if (column.is_text) {
+        table_row->AddTextCell(column.text[row]);
+      } else if (column.is_id) {
+        table_row->AddTextCell(absl::StrCat(column.ids[row]));
+      } else {
+        table_row->AddNumberCell(column.numbers[row]);
+      }
+    }
+  }
+  return data_table;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
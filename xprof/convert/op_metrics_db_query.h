@@ -0,0 +1,89 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XPROF_CONVERT_OP_METRICS_DB_QUERY_H_
+#define XPROF_CONVERT_OP_METRICS_DB_QUERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xprof/convert/data_table_utils.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Ad-hoc queries over the top-level ops of an OpMetricsDb.
+//
+// A query is a sequence of stages separated by '|':
+//   filter <column> <op> <value> [and <column> <op> <value>]...
+//       <op> is one of ==, !=, <, <=, >, >= or ~ (substring match, text only).
+//       Text values may be quoted.
+//   group <column>[, <column>]...
+//   agg <fn>(<column>)[, <fn>(<column>)]...
+//       <fn> is one of count, sum, avg, min or max; count takes no column.
+//   top <k> [by <output column>]
+// Filters are applied first. If the query groups or aggregates, it returns one
+// row per group (a single row without group) with the group columns and the
+// aggregates, which default to count() and sum(self_time_ps). Otherwise it
+// returns the filtered ops. Rows are sorted by decreasing value of the "by"
+// column, which defaults to the first aggregate (sum(self_time_ps) for the
+// default aggregates) or to self_time_ps for ops. Column values are compared
+// and grouped exactly as integers; identifiers such as hlo_module_id are
+// returned as text and sorted in increasing order.
+//
+// Example: total time of fusions accessing more than 1 GB, per program:
+//   filter category == fusion and bytes_accessed > 1e9 | group hlo_module_id |
+//   agg sum(time_ps), count()
+struct OpMetricsQuery {
+  enum class Comparison { kEq, kNe, kLt, kLe, kGt, kGe, kContains };
+  struct Predicate {
+    std::string column;
+    Comparison comparison;
+    std::string text;
+    double number = 0.0;
+    // Set if the value is an unsigned integer, which is compared exactly.
+    std::optional<uint64_t> integer;
+  };
+  enum class Function { kCount, kSum, kAvg, kMin, kMax };
+  struct Aggregate {
+    Function function;
+    std::string column;  // Empty for count.
+    std::string OutputName() const;
+  };
+
+  std::vector<Predicate> filters;
+  std::vector<std::string> group_by;
+  std::vector<Aggregate> aggregates;
+  std::optional<size_t> top_k;
+  std::string order_by;
+};
+
+absl::StatusOr<OpMetricsQuery> ParseOpMetricsQuery(absl::string_view query);
+
+// Runs `query` over `db` and returns the result as a DataTable.
+absl::StatusOr<std::unique_ptr<DataTable>> RunOpMetricsQuery(
+    const OpMetricsDb& db, const OpMetricsQuery& query);
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // XPROF_CONVERT_OP_METRICS_DB_QUERY_H_
@@ -0,0 +1,139 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/op_metrics_db_query.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "<gtest/gtest.h>"
+#include "xprof/convert/data_table_utils.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+OpMetricsDb CreateOpMetricsDb() {
+  OpMetricsDb db;
+  auto add_op = [&db](absl::string_view name, absl::string_view category,
+                      uint64_t program_id, uint64_t self_time_ps,
+                      uint64_t bytes_accessed) {
+    OpMetrics* metrics = db.add_metrics_db();
+    metrics->set_name(std::string(name));
+    metrics->set_category(std::string(category));
+    metrics->set_hlo_module_id(program_id);
+    metrics->set_occurrences(1);
+    metrics->set_time_ps(self_time_ps);
+    metrics->set_self_time_ps(self_time_ps);
+    metrics->set_bytes_accessed(bytes_accessed);
+  };
+  add_op("fusion.1", "loop fusion", 1, 300, 2000000000);
+  add_op("fusion.2", "loop fusion", 1, 100, 10);
+  add_op("fusion.3", "output fusion", 2, 500, 3000000000);
+  add_op("copy.1", "copy", 2, 50, 4000000000);
+  add_op("fusion.4", "loop fusion", 2, 200, 1500000000);
+  return db;
+}
+
+// Returns the cell values of each row as strings.
+std::vector<std::vector<std::string>> RunQuery(
+    absl::string_view query, const OpMetricsDb& db = CreateOpMetricsDb()) {
+  absl::StatusOr<OpMetricsQuery> parsed = ParseOpMetricsQuery(query);
+  EXPECT_TRUE(parsed.ok()) << parsed.status();
+  absl::StatusOr<std::unique_ptr<DataTable>> table =
+      RunOpMetricsQuery(db, *parsed);
+  EXPECT_TRUE(table.ok()) << table.status();
+  std::vector<std::vector<std::string>> rows;
+  for (const TableRow* row : (*table)->GetRows()) {
+    std::vector<std::string>& cells = rows.emplace_back();
+    for (const TableCell* cell : row->GetCells()) {
+      cells.push_back(cell->GetCellValueStr());
+    }
+  }
+  return rows;
+}
+
+TEST(OpMetricsDbQueryTest, FilterGroupAndAggregate) {
+  EXPECT_EQ(RunQuery("filter category ~ fusion and bytes_accessed > 1e9 | "
+                "group hlo_module_id | agg sum(time_ps), count()"),
+            (std::vector<std::vector<std::string>>{{"2", "700", "2"},
+                                                   {"1", "300", "1"}}));
+}
+
+TEST(OpMetricsDbQueryTest, GroupsAndFiltersLargeIdsExactly) {
+  // Fingerprints above 2^53 that differ only in the lowest bit.
+  OpMetricsDb db;
+  for (uint64_t program_id :
+       {18000000000000000001ull, 18000000000000000000ull,
+        18000000000000000001ull}) {
+    OpMetrics* metrics = db.add_metrics_db();
+    metrics->set_name("fusion");
+    metrics->set_hlo_module_id(program_id);
+    metrics->set_self_time_ps(10);
+  }
+
+  EXPECT_EQ(RunQuery("group hlo_module_id | top 2 by hlo_module_id", db),
+            (std::vector<std::vector<std::string>>{
+                {"18000000000000000000", "1", "10"},
+                {"18000000000000000001", "2", "20"}}));
+  EXPECT_EQ(RunQuery("filter hlo_module_id == 18000000000000000000 | "
+                     "agg count()",
+                     db),
+            (std::vector<std::vector<std::string>>{{"1"}}));
+}
+
+TEST(OpMetricsDbQueryTest, DefaultAggregates) {
+  EXPECT_EQ(RunQuery("group category"),
+            (std::vector<std::vector<std::string>>{
+                {"loop fusion", "3", "600"},
+                {"output fusion", "1", "500"},
+                {"copy", "1", "50"}}));
+  EXPECT_EQ(RunQuery("agg max(bytes_accessed)"),
+            (std::vector<std::vector<std::string>>{{"4e+09"}}));
+}
+
+TEST(OpMetricsDbQueryTest, TopOps) {
+  std::vector<std::vector<std::string>> rows =
+      RunQuery("filter category == 'loop fusion' | top 2");
+  ASSERT_EQ(rows.size(), 2);
+  EXPECT_EQ(rows[0][0], "fusion.1");
+  EXPECT_EQ(rows[1][0], "fusion.4");
+
+  rows = RunQuery("group category | top 1 by count()");
+  ASSERT_EQ(rows.size(), 1);
+  EXPECT_EQ(rows[0][0], "loop fusion");
+}
+
+TEST(OpMetricsDbQueryTest, InvalidQueries) {
+  EXPECT_FALSE(ParseOpMetricsQuery("filter unknown == 1").ok());
+  EXPECT_FALSE(ParseOpMetricsQuery("filter category > 1").ok());
+  EXPECT_FALSE(ParseOpMetricsQuery("filter time_ps ~ 1").ok());
+  EXPECT_FALSE(ParseOpMetricsQuery("agg sum(category)").ok());
+  EXPECT_FALSE(ParseOpMetricsQuery("filter name == 'a").ok());
+  EXPECT_FALSE(ParseOpMetricsQuery("sort name").ok());
+  absl::StatusOr<OpMetricsQuery> query =
+      ParseOpMetricsQuery("group category | top 1 by flops");
+  ASSERT_TRUE(query.ok());
+  EXPECT_FALSE(RunOpMetricsQuery(CreateOpMetricsDb(), *query).ok());
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -16,7 +16,7 @@ limitations under the License.
 #ifndef XPROF_CONVERT_OP_STACK_H_
 #define XPROF_CONVERT_OP_STACK_H_
 
-#include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -26,33 +26,35 @@ namespace tensorflow {
 namespace profiler {
 using tsl::uint32;
 
+// A stack of in-flight ops. OpInfo is stored inline so that the storage of
+// popped entries is reused by later pushes instead of being allocated per op.
 template <typename OpInfo>
 class OpStack {
  public:
   // Pushes an Op onto the stack.
-  void Push(uint32 op_id, std::unique_ptr<OpInfo> op_info) {
+  void Push(uint32 op_id, OpInfo op_info) {
     stack_.emplace_back(op_id, std::move(op_info));
   }
 
   // Pops the Op with the given op_id from the stack.
-  std::unique_ptr<OpInfo> Pop(uint32 op_id) {
+  std::optional<OpInfo> Pop(uint32 op_id) {
     // Pop until match or stack_ is empty.
-    std::unique_ptr<OpInfo> result;
+    std::optional<OpInfo> result;
     while (!stack_.empty()) {
-      auto back = std::move(stack_.back());
-      stack_.pop_back();
+      auto& back = stack_.back();
       if (op_id == back.first) {
-        result = std::move(back.second);
+        result.emplace(std::move(back.second));
+        stack_.pop_back();
         break;
       }
+      stack_.pop_back();
     }
     return result;
   }
 
-  // Returns the Op at the top of the stack.
-  OpInfo* Top() const {
-    return stack_.empty() ? nullptr : stack_.back().second.get();
-  }
+  // Returns the Op at the top of the stack. The pointer is invalidated by the
+  // next Push, Pop or Clear.
+  OpInfo* Top() { return stack_.empty() ? nullptr : &stack_.back().second; }
 
   // Returns true if the stack is empty.
   bool Empty() const { return stack_.empty(); }
@@ -61,7 +63,7 @@ class OpStack {
   void Clear() { stack_.clear(); }
 
  private:
-  std::vector<std::pair<uint32 /*op_id*/, std::unique_ptr<OpInfo>>> stack_;
+  std::vector<std::pair<uint32 /*op_id*/, OpInfo>> stack_;
 };
 
 }  // namespace profiler
@@ -17,9 +17,12 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/log/log.h"
 #include "xla/tsl/platform/types.h"
 #include "xprof/convert/op_metrics_db_combiner.h"
 #include "xprof/convert/xplane_to_tf_functions.h"
@@ -31,6 +34,7 @@ limitations under the License.
 #include "plugin/xprof/protobuf/power_metrics.pb.h"
 #include "plugin/xprof/protobuf/steps_db.pb.h"
 #include "plugin/xprof/protobuf/topology.pb.h"
+#include "xprof/utils/diagnostics.h"
 #include "xprof/utils/hardware_type_utils.h"
 #include "xprof/utils/kernel_stats_utils.h"
 #include "xprof/utils/step_intersection.h"
@@ -302,6 +306,32 @@ void CombineAllOpStats(const std::vector<OpStatsInfo>& all_op_stats_info,
                    &hlo_metrics_db_per_step_combiners);
   }
 
+  // Combines the time-sliced device op metrics of the hosts that have them.
+  // Slices of different durations cannot be merged; hosts whose duration
+  // differs from the first one are left out.
+  std::optional<TimeSlicedOpMetricsDbBuilder> time_sliced_builder;
+  uint64_t slice_duration_ps = 0;
+  for (const auto& op_stats_info : all_op_stats_info) {
+    const TimeSlicedOpMetricsDb& src =
+        op_stats_info.op_stats->time_sliced_device_op_metrics_db();
+    if (src.slice_duration_ps() == 0) continue;
+    if (!time_sliced_builder.has_value()) {
+      slice_duration_ps = src.slice_duration_ps();
+      time_sliced_builder.emplace(slice_duration_ps);
+    } else if (src.slice_duration_ps() != slice_duration_ps) {
+      LOG(WARNING) << "Skipping the time-sliced op metrics of host "
+                   << op_stats_info.src_host_id << ": slice duration "
+                   << src.slice_duration_ps() << "ps differs from "
+                   << slice_duration_ps << "ps.";
+      continue;
+    }
+    time_sliced_builder->Combine(src);
+  }
+  if (time_sliced_builder.has_value()) {
+    *combined_op_stats->mutable_time_sliced_device_op_metrics_db() =
+        time_sliced_builder->Finalize();
+  }
+
   // Sorts all the kernel reports that have been merged by CombineTfOpStats and
   // keeps only the top kernel reports with long kernel duration.
   SortAndKeepTopKDurationKernelReportsInDb(
@@ -313,6 +343,8 @@ void CombineAllOpStats(const std::vector<OpStatsInfo>& all_op_stats_info,
           combined_op_stats->performance_counter_result()
               .matrix_unit_utilization_percent() /
           all_op_stats_info.size());
+
+  FinalizeStepDiagnostics(combined_op_stats);
 }
 
 }  // namespace profiler
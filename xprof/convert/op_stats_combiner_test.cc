@@ -15,14 +15,18 @@ limitations under the License.
 
 #include "xprof/convert/op_stats_combiner.h"
 
+#include <cstdint>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "xla/tsl/platform/types.h"
 #include "<gtest/gtest.h>"
+#include "plugin/xprof/protobuf/diagnostics.pb.h"
 #include "plugin/xprof/protobuf/hardware_types.pb.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
 #include "plugin/xprof/protobuf/op_stats.pb.h"
 #include "plugin/xprof/protobuf/steps_db.pb.h"
+#include "xprof/utils/diagnostics.h"
 #include "xprof/utils/step_intersection.h"
 
 namespace tensorflow {
@@ -120,6 +124,53 @@ TEST(CombineAllOpStatsTest, CombineRunEnvironmentWithMismatchHardwareType) {
   EXPECT_EQ(dst_op_stats.run_environment().hardware_type(), HardwareType::TPU);
 }
 
+TEST(CombineAllOpStatsTest, StepDiagnosticsAreFinalized) {
+  OpStats op_stats, dst_op_stats;
+  CombineAllOpStats({OpStatsInfo(&op_stats, TPU, 0)}, StepIntersection(1, {}),
+                    &dst_op_stats);
+
+  ASSERT_TRUE(dst_op_stats.has_step_diagnostics());
+  ASSERT_EQ(dst_op_stats.step_diagnostics().warnings_size(), 1);
+  EXPECT_EQ(dst_op_stats.step_diagnostics().warnings(0), kErrorNoStepMarker);
+
+  // The stored diagnostics are used instead of re-evaluating the checks.
+  dst_op_stats.mutable_step_db()->set_use_incomplete_step(true);
+  Diagnostics diag;
+  PopulateStepDiagnostics(dst_op_stats, &diag);
+  ASSERT_EQ(diag.warnings_size(), 1);
+  EXPECT_EQ(diag.warnings(0), kErrorNoStepMarker);
+}
+
+TEST(CombineAllOpStatsTest, SkipsTimeSlicesOfAnotherDuration) {
+  auto add_slice = [](uint64_t slice_duration_ps, uint64_t self_time_ps,
+                      OpStats& op_stats) {
+    TimeSlicedOpMetricsDb* db =
+        op_stats.mutable_time_sliced_device_op_metrics_db();
+    db->set_slice_duration_ps(slice_duration_ps);
+    OpMetrics* metrics =
+        db->add_slices()->mutable_op_metrics_db()->add_metrics_db();
+    metrics->set_name("fusion");
+    metrics->set_occurrences(1);
+    metrics->set_self_time_ps(self_time_ps);
+  };
+  OpStats op_stats_1, op_stats_2, op_stats_3, dst_op_stats;
+  add_slice(1000, 10, op_stats_1);
+  add_slice(500, 20, op_stats_2);
+  add_slice(1000, 30, op_stats_3);
+  CombineAllOpStats({OpStatsInfo(&op_stats_1, TPU, 0),
+                     OpStatsInfo(&op_stats_2, TPU, 1),
+                     OpStatsInfo(&op_stats_3, TPU, 2)},
+                    StepIntersection(1, {}), &dst_op_stats);
+
+  const TimeSlicedOpMetricsDb& combined =
+      dst_op_stats.time_sliced_device_op_metrics_db();
+  EXPECT_EQ(combined.slice_duration_ps(), 1000);
+  ASSERT_EQ(combined.slices_size(), 1);
+  ASSERT_EQ(combined.slices(0).op_metrics_db().metrics_db_size(), 1);
+  EXPECT_EQ(combined.slices(0).op_metrics_db().metrics_db(0).self_time_ps(),
+            40);
+}
+
 }  // namespace
 }  // namespace profiler
 }  // namespace tensorflow
@@ -0,0 +1,194 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/op_stats_diff.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "xla/tsl/profiler/utils/math_utils.h"
+#include "xprof/convert/data_table_utils.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
+#include "plugin/xprof/protobuf/op_stats.pb.h"
+#include "plugin/xprof/protobuf/steps_db.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+using AlignedRows = absl::flat_hash_map<std::string, OpStatsDiffRow>;
+
+bool HasDeviceOps(const OpStats& op_stats) {
+  return !op_stats.device_op_metrics_db().metrics_db().empty();
+}
+
+// Returns the device op metrics if the profile has any, otherwise the host op
+// metrics.
+const OpMetricsDb& ComparedOpMetricsDb(const OpStats& op_stats) {
+  return HasDeviceOps(op_stats) ? op_stats.device_op_metrics_db()
+                                : op_stats.host_op_metrics_db();
+}
+
+void AddToRow(uint64_t occurrences, double time_us, bool is_baseline,
+              OpStatsDiffRow& row) {
+  if (is_baseline) {
+    row.baseline_occurrences += occurrences;
+    row.baseline_time_us += time_us;
+  } else {
+    row.current_occurrences += occurrences;
+    row.current_time_us += time_us;
+  }
+}
+
+void AddOpMetricsDb(const OpMetricsDb& db, bool is_baseline, AlignedRows& ops,
+                    AlignedRows& categories) {
+  for (const OpMetrics& metrics : db.metrics_db()) {
+    double self_time_us = tsl::profiler::PicoToMicro(metrics.self_time_ps());
+    OpStatsDiffRow& op = ops[metrics.name()];
+    if (op.category.empty()) op.category = metrics.category();
+    AddToRow(metrics.occurrences(), self_time_us, is_baseline, op);
+    AddToRow(metrics.occurrences(), self_time_us, is_baseline,
+             categories[metrics.category()]);
+  }
+}
+
+// A step takes as long as its slowest core.
+void AddStepDb(const StepDatabaseResult& step_db, bool is_baseline,
+               AlignedRows& steps) {
+  for (int i = 0; i < step_db.step_sequence_size(); ++i) {
+    uint64_t duration_ps = 0;
+    for (const auto& [core_id, step_info] :
+         step_db.step_sequence(i).step_info_per_core()) {
+      duration_ps = std::max(duration_ps, step_info.duration_ps());
+    }
+    AddToRow(1, tsl::profiler::PicoToMicro(duration_ps), is_baseline,
+             steps[absl::StrCat(i)]);
+  }
+}
+
+bool IsSignificant(const OpStatsDiffRow& row,
+                   const OpStatsDiffOptions& options) {
+  if (std::abs(row.DeltaUs()) < options.min_delta_us) return false;
+  return row.baseline_time_us <= 0.0 ||
+         std::abs(row.RelativeDelta()) >= options.min_relative_delta;
+}
+
+std::vector<OpStatsDiffRow> SignificantRows(AlignedRows rows,
+                                            const OpStatsDiffOptions& options) {
+  std::vector<OpStatsDiffRow> result;
+  for (auto& [name, row] : rows) {
+    if (!IsSignificant(row, options)) continue;
+    row.name = name;
+    result.push_back(std::move(row));
+  }
+  absl::c_sort(result, [](const OpStatsDiffRow& a, const OpStatsDiffRow& b) {
+    double delta_a = std::abs(a.DeltaUs());
+    double delta_b = std::abs(b.DeltaUs());
+    return delta_a != delta_b ? delta_a > delta_b : a.name < b.name;
+  });
+  return result;
+}
+
+DataTable CreateDiffDataTable(absl::string_view table_name,
+                              absl::string_view name_label,
+                              absl::string_view time_label,
+                              const std::vector<OpStatsDiffRow>& rows) {
+  DataTable data_table;
+  data_table.AddCustomProperty("table", std::string(table_name));
+  data_table.AddColumn(TableColumn("name", "string", std::string(name_label)));
+  data_table.AddColumn(TableColumn("category", "string", "Category"));
+  data_table.AddColumn(
+      TableColumn("baseline_occurrences", "number", "Baseline #Occurrences"));
+  data_table.AddColumn(
+      TableColumn("current_occurrences", "number", "Current #Occurrences"));
+  data_table.AddColumn(TableColumn("baseline_time", "number",
+                                   absl::StrCat("Baseline ", time_label)));
+  data_table.AddColumn(TableColumn("current_time", "number",
+                                   absl::StrCat("Current ", time_label)));
+  data_table.AddColumn(TableColumn("delta", "number", "Delta (us)"));
+  data_table.AddColumn(
+      TableColumn("relative_delta_percent", "number", "Delta (%)"));
+  for (const OpStatsDiffRow& row : rows) {
+    TableRow* table_row = data_table.AddRow();
+    table_row->AddTextCell(row.name);
+    table_row->AddTextCell(row.category);
+    table_row->AddNumberCell(row.baseline_occurrences);
+    table_row->AddNumberCell(row.current_occurrences);
+    table_row->AddNumberCell(row.baseline_time_us);
+    table_row->AddNumberCell(row.current_time_us);
+    table_row->AddNumberCell(row.DeltaUs());
+    table_row->AddNumberCell(row.RelativeDelta() * 100.0);
+  }
+  return data_table;
+}
+
+}  // namespace
+
+absl::StatusOr<OpStatsDiff> ComputeOpStatsDiff(
+    const OpStats& baseline, const OpStats& current,
+    const OpStatsDiffOptions& options) {
+  // Device and host ops have unrelated names and times. A profile without any
+  // ops can be compared with either.
+  if (HasDeviceOps(baseline) != HasDeviceOps(current) &&
+      !ComparedOpMetricsDb(baseline).metrics_db().empty() &&
+      !ComparedOpMetricsDb(current).metrics_db().empty()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Cannot compare the ", HasDeviceOps(current) ? "device" : "host",
+        " ops of this session with the ",
+        HasDeviceOps(baseline) ? "device" : "host",
+        " ops of the baseline session."));
+  }
+  AlignedRows ops, categories, steps;
+  AddOpMetricsDb(ComparedOpMetricsDb(baseline), /*is_baseline=*/true, ops,
+                 categories);
+  AddOpMetricsDb(ComparedOpMetricsDb(current), /*is_baseline=*/false, ops,
+                 categories);
+  AddStepDb(baseline.step_db(), /*is_baseline=*/true, steps);
+  AddStepDb(current.step_db(), /*is_baseline=*/false, steps);
+
+  OpStatsDiff diff;
+  diff.ops = SignificantRows(std::move(ops), options);
+  diff.categories = SignificantRows(std::move(categories), options);
+  diff.steps = SignificantRows(std::move(steps), options);
+  return diff;
+}
+
+std::string OpStatsDiffToDataTableJson(const OpStatsDiff& diff) {
+  return absl::StrCat(
+      "[",
+      CreateDiffDataTable("ops", "Op name", "self time (us)", diff.ops)
+          .ToJson(),
+      ",",
+      CreateDiffDataTable("categories", "Op category", "self time (us)",
+                          diff.categories)
+          .ToJson(),
+      ",",
+      CreateDiffDataTable("steps", "Step", "step time (us)", diff.steps)
+          .ToJson(),
+      "]");
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
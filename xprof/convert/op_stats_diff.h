@@ -0,0 +1,81 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XPROF_CONVERT_OP_STATS_DIFF_H_
+#define XPROF_CONVERT_OP_STATS_DIFF_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "plugin/xprof/protobuf/op_stats.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Thresholds deciding which differences between two profiles are reported. A
+// row is reported only if it passes both thresholds.
+struct OpStatsDiffOptions {
+  // Minimum absolute change of the compared time, in microseconds.
+  double min_delta_us = 1.0;
+  // Minimum change of the compared time relative to the baseline. Rows that are
+  // absent from the baseline always pass this threshold.
+  double min_relative_delta = 0.05;
+};
+
+// The values of one aligned row in the baseline and the current profile.
+struct OpStatsDiffRow {
+  // Op name, op category or step index, depending on the table.
+  std::string name;
+  std::string category;
+  uint64_t baseline_occurrences = 0;
+  uint64_t current_occurrences = 0;
+  // Total self time for ops and categories, step time for steps.
+  double baseline_time_us = 0.0;
+  double current_time_us = 0.0;
+
+  double DeltaUs() const { return current_time_us - baseline_time_us; }
+  // Returns the delta relative to the baseline, or 0 if the row is absent from
+  // the baseline.
+  double RelativeDelta() const {
+    return baseline_time_us > 0.0 ? DeltaUs() / baseline_time_us : 0.0;
+  }
+};
+
+// Differences between a baseline and a current OpStats. Ops are aligned by
+// name and steps by their position in the step sequence, since program ids and
+// step numbers are not stable across runs. Rows are sorted by decreasing
+// absolute delta.
+struct OpStatsDiff {
+  std::vector<OpStatsDiffRow> ops;
+  std::vector<OpStatsDiffRow> categories;
+  std::vector<OpStatsDiffRow> steps;
+};
+
+// Both profiles are compared on their device op metrics if they have any,
+// otherwise on their host op metrics. Returns an error if one profile has
+// device ops and the other only host ops.
+absl::StatusOr<OpStatsDiff> ComputeOpStatsDiff(
+    const OpStats& baseline, const OpStats& current,
+    const OpStatsDiffOptions& options);
+
+// Converts to a JSON array of the op, category and step DataTables.
+std::string OpStatsDiffToDataTableJson(const OpStatsDiff& diff);
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // XPROF_CONVERT_OP_STATS_DIFF_H_
@@ -0,0 +1,124 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xprof/convert/op_stats_diff.h"
+
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "xla/tsl/platform/status_matchers.h"
+#include "<gtest/gtest.h>"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
+#include "plugin/xprof/protobuf/op_stats.pb.h"
+#include "plugin/xprof/protobuf/steps_db.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+void AddOp(const char* name, const char* category, uint64_t self_time_us,
+           OpStats& op_stats) {
+  OpMetrics* metrics =
+      op_stats.mutable_device_op_metrics_db()->add_metrics_db();
+  metrics->set_name(name);
+  metrics->set_category(category);
+  metrics->set_occurrences(1);
+  metrics->set_self_time_ps(self_time_us * 1000000);
+}
+
+void AddStep(uint64_t duration_us, OpStats& op_stats) {
+  PerCoreStepInfo* step =
+      op_stats.mutable_step_db()->add_step_sequence();
+  (*step->mutable_step_info_per_core())[0].set_duration_ps(duration_us *
+                                                           1000000);
+  (*step->mutable_step_info_per_core())[1].set_duration_ps(duration_us *
+                                                           500000);
+}
+
+TEST(OpStatsDiffTest, AlignsOpsCategoriesAndSteps) {
+  OpStats baseline;
+  AddOp("fusion.1", "fusion", 100, baseline);
+  AddOp("fusion.2", "fusion", 50, baseline);
+  AddOp("copy.1", "copy", 10, baseline);
+  AddStep(1000, baseline);
+  AddStep(1000, baseline);
+
+  OpStats current;
+  AddOp("fusion.1", "fusion", 150, current);
+  AddOp("fusion.2", "fusion", 51, current);
+  AddOp("convolution.1", "convolution", 20, current);
+  AddStep(1000, current);
+  AddStep(900, current);
+
+  TF_ASSERT_OK_AND_ASSIGN(OpStatsDiff diff,
+                          ComputeOpStatsDiff(baseline, current, {}));
+
+  // fusion.2 changed by only 2%.
+  ASSERT_EQ(diff.ops.size(), 3);
+  EXPECT_EQ(diff.ops[0].name, "fusion.1");
+  EXPECT_EQ(diff.ops[0].category, "fusion");
+  EXPECT_DOUBLE_EQ(diff.ops[0].DeltaUs(), 50.0);
+  EXPECT_DOUBLE_EQ(diff.ops[0].RelativeDelta(), 0.5);
+  EXPECT_EQ(diff.ops[1].name, "convolution.1");
+  EXPECT_EQ(diff.ops[1].baseline_occurrences, 0);
+  EXPECT_EQ(diff.ops[1].current_occurrences, 1);
+  EXPECT_EQ(diff.ops[2].name, "copy.1");
+  EXPECT_DOUBLE_EQ(diff.ops[2].DeltaUs(), -10.0);
+
+  ASSERT_EQ(diff.categories.size(), 3);
+  EXPECT_EQ(diff.categories[0].name, "fusion");
+  EXPECT_DOUBLE_EQ(diff.categories[0].DeltaUs(), 51.0);
+  EXPECT_EQ(diff.categories[1].name, "convolution");
+  EXPECT_EQ(diff.categories[2].name, "copy");
+
+  // Steps take as long as their slowest core.
+  ASSERT_EQ(diff.steps.size(), 1);
+  EXPECT_EQ(diff.steps[0].name, "1");
+  EXPECT_DOUBLE_EQ(diff.steps[0].baseline_time_us, 1000.0);
+  EXPECT_DOUBLE_EQ(diff.steps[0].current_time_us, 900.0);
+}
+
+TEST(OpStatsDiffTest, ThresholdsAreConfigurable) {
+  OpStats baseline;
+  AddOp("fusion.1", "fusion", 100, baseline);
+  OpStats current;
+  AddOp("fusion.1", "fusion", 102, current);
+
+  EXPECT_TRUE(ComputeOpStatsDiff(baseline, current, {})->ops.empty());
+  OpStatsDiffOptions options;
+  options.min_relative_delta = 0.01;
+  EXPECT_EQ(ComputeOpStatsDiff(baseline, current, options)->ops.size(), 1);
+  options.min_delta_us = 5.0;
+  EXPECT_TRUE(ComputeOpStatsDiff(baseline, current, options)->ops.empty());
+}
+
+TEST(OpStatsDiffTest, DeviceOpsAreNotComparedWithHostOps) {
+  OpStats baseline;
+  AddOp("fusion.1", "fusion", 100, baseline);
+  OpStats current;
+  OpMetrics* metrics = current.mutable_host_op_metrics_db()->add_metrics_db();
+  metrics->set_name("MatMul");
+  metrics->set_self_time_ps(100000000);
+
+  EXPECT_EQ(ComputeOpStatsDiff(baseline, current, {}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(ComputeOpStatsDiff(current, baseline, {}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_TRUE(ComputeOpStatsDiff(OpStats(), current, {}).ok());
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
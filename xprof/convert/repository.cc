@@ -16,18 +16,25 @@ limitations under the License.
 #include "xprof/convert/repository.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/arena.h"
 #include "xla/tsl/platform/env.h"
 #include "xla/tsl/platform/errors.h"
@@ -39,6 +46,63 @@ limitations under the License.
 namespace tensorflow {
 namespace profiler {
 namespace {
+
+ABSL_CONST_INIT absl::Mutex fast_file_locator_mu(absl::kConstInit);
+// Readers hold a reference, so the locator outlives a concurrent replacement.
+std::shared_ptr<const FastFileLocator>* fast_file_locator
+    ABSL_GUARDED_BY(fast_file_locator_mu) = nullptr;
+
+std::shared_ptr<const FastFileLocator> GetFastFileLocator() {
+  absl::MutexLock lock(&fast_file_locator_mu);
+  if (fast_file_locator == nullptr) return nullptr;
+  return *fast_file_locator;
+}
+
+// Escapes <session_run_dir> into a file name prefix. Every byte other than an
+// ASCII letter or digit is written as '_' and two hex digits, so different run
+// dirs never share a prefix.
+std::string EscapeRunDir(absl::string_view session_run_dir) {
+  std::string escaped;
+  for (char c : session_run_dir) {
+    if (absl::ascii_isalnum(c)) {
+      escaped.push_back(c);
+    } else {
+      absl::StrAppend(&escaped, "_",
+                      absl::Hex(static_cast<uint8_t>(c), absl::kZeroPad2));
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+void RegisterFastFileLocator(FastFileLocator locator) {
+  absl::MutexLock lock(&fast_file_locator_mu);
+  if (fast_file_locator == nullptr) {
+    fast_file_locator = new std::shared_ptr<const FastFileLocator>();
+  } else if (*fast_file_locator != nullptr && locator) {
+    LOG(WARNING) << "Multiple calls to RegisterFastFileLocator. Last call "
+                    "wins, but because order of initialization in C++ is "
+                    "nondeterministic, this may not be what you want.";
+  }
+  *fast_file_locator =
+      locator ? std::make_shared<const FastFileLocator>(std::move(locator))
+              : nullptr;
+}
+
+FastFileLocator ScratchDirFastFileLocator(std::string scratch_dir) {
+  return [scratch_dir = std::move(scratch_dir)](
+             absl::string_view session_run_dir,
+             absl::string_view file_name) -> std::optional<std::string> {
+    if (!tsl::Env::Default()->RecursivelyCreateDir(scratch_dir).ok()) {
+      return std::nullopt;
+    }
+    return tsl::io::JoinPath(
+        scratch_dir,
+        absl::StrCat(EscapeRunDir(session_run_dir), ".", file_name));
+  };
+}
+namespace {
 std::string GetHostnameByPath(absl::string_view xspace_path) {
   std::string_view file_name = tsl::io::Basename(xspace_path);
   // Remove suffix from file_name, preserving entire prefix.
@@ -119,12 +183,20 @@ std::string SessionSnapshot::GetHostname(size_t index) const {
 
 std::optional<std::string> SessionSnapshot::GetFilePath(
     absl::string_view toolname, absl::string_view hostname) const {
-  if (!has_accessible_run_dir_) return std::nullopt;
   std::string file_name = "";
   if (toolname == "trace_viewer@")
     file_name = absl::StrCat(hostname, ".", "SSTABLE");
-  if (!file_name.empty()) return tsl::io::JoinPath(session_run_dir_, file_name);
-  return std::nullopt;
+  if (file_name.empty()) return std::nullopt;
+  if (has_accessible_run_dir_) {
+    return tsl::io::JoinPath(session_run_dir_, file_name);
+  }
+  std::shared_ptr<const FastFileLocator> locator = GetFastFileLocator();
+  if (locator == nullptr) return std::nullopt;
+  return (*locator)(session_run_dir_, file_name);
+}
+
+bool SessionSnapshot::HasFastFileStorage() const {
+  return has_accessible_run_dir_ || GetFastFileLocator() != nullptr;
 }
 
 absl::StatusOr<std::string> SessionSnapshot::GetHostDataFileName(
@@ -17,6 +17,7 @@ limitations under the License.
 #define XPROF_CONVERT_REPOSITORY_H_
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -52,6 +53,25 @@ static auto* kHostDataSuffixes =
         {{StoredDataType::DCN_COLLECTIVE_STATS, ".dcn_collective_stats.pb"},
          {StoredDataType::OP_STATS, ".op_stats.pb"}});
 
+// Returns the path where the fast file <file_name> of the session with run
+// directory <session_run_dir> is stored, or nullopt if it can't be stored.
+using FastFileLocator = std::function<std::optional<std::string>(
+    absl::string_view session_run_dir, absl::string_view file_name)>;
+
+// Registers where the fast files of sessions without an accessible run
+// directory are stored, e.g. a local scratch directory or an in-memory file
+// system. Without one, tools that need fast files are unavailable for such
+// sessions. There can only be one active locator, and the last call to this
+// function wins. An empty locator unregisters the active one. Thread-safe; the
+// locator itself may be called concurrently from several threads.
+void RegisterFastFileLocator(FastFileLocator locator);
+
+// Returns a locator that stores fast files in <scratch_dir>, which may be on
+// any file system registered with tsl::Env. File names are prefixed with the
+// escaped session run directory so that sessions don't overwrite each other's
+// files.
+FastFileLocator ScratchDirFastFileLocator(std::string scratch_dir);
+
 // File system directory snapshot of a profile session.
 class SessionSnapshot {
  public:
@@ -85,10 +105,15 @@ class SessionSnapshot {
   // path-based file read will be disabled in this mode.
   bool HasAccessibleRunDir() const { return has_accessible_run_dir_; }
 
-  // Gets the path of the fast file for a given tool.
+  // Gets the path of the fast file for a given tool. The file is in the run
+  // dir, or in the registered fast file location if the run dir is not
+  // accessible.
   std::optional<std::string> GetFilePath(absl::string_view toolname,
                                          absl::string_view host) const;
 
+  // Gets whether fast files can be stored for this session.
+  bool HasFastFileStorage() const;
+
   // Gets the name of the host data file.
   absl::StatusOr<std::string> GetHostDataFileName(StoredDataType data_type,
                                                   std::string host) const;
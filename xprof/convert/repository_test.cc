@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -119,6 +120,48 @@ TEST(Repository, GetSSTableFileWithXSpace) {
   EXPECT_THAT(file_path_init_by_xspace, Eq(std::nullopt));
 }
 
+TEST(Repository, GetSSTableFileWithXSpaceAndFastFileLocator) {
+  std::vector<std::unique_ptr<XSpace>> xspaces;
+  auto space0 = std::make_unique<XSpace>();
+  *(space0->add_hostnames()) = "hostname0";
+  xspaces.push_back(std::move(space0));
+  auto session_snapshot_or = SessionSnapshot::Create(
+      {"log/plugins/profile/hostname0.xplane.pb"}, std::move(xspaces));
+  TF_CHECK_OK(session_snapshot_or.status());
+  std::string scratch_dir = tsl::io::JoinPath(::testing::TempDir(), "fast");
+  RegisterFastFileLocator(ScratchDirFastFileLocator(scratch_dir));
+  auto sstable_path =
+      session_snapshot_or.value().GetFilePath("trace_viewer@", "hostname0");
+  auto not_found_path =
+      session_snapshot_or.value().GetFilePath("memory_viewer", "hostname0");
+  EXPECT_TRUE(session_snapshot_or.value().HasFastFileStorage());
+  RegisterFastFileLocator(nullptr);
+
+  EXPECT_THAT(sstable_path,
+              Eq(tsl::io::JoinPath(
+                  scratch_dir,
+                  "log_2fplugins_2fprofile.hostname0.SSTABLE")));
+  EXPECT_THAT(not_found_path, Eq(std::nullopt));
+  EXPECT_FALSE(session_snapshot_or.value().HasFastFileStorage());
+}
+
+TEST(Repository, ScratchDirFastFileLocatorKeepsRunDirsApart) {
+  FastFileLocator locator = ScratchDirFastFileLocator(
+      tsl::io::JoinPath(::testing::TempDir(), "fast"));
+  std::vector<std::string> run_dirs = {"a/b-c", "a/b_c", "a_2fb-c", "a.b/c"};
+  std::vector<std::string> paths;
+  for (const std::string& run_dir : run_dirs) {
+    std::optional<std::string> path = locator(run_dir, "host.SSTABLE");
+    ASSERT_TRUE(path.has_value());
+    paths.push_back(*path);
+  }
+  for (int i = 0; i < paths.size(); ++i) {
+    for (int j = i + 1; j < paths.size(); ++j) {
+      EXPECT_NE(paths[i], paths[j]) << run_dirs[i] << " " << run_dirs[j];
+    }
+  }
+}
+
 TEST(Repository, MismatchedXSpaceAndPath) {
   std::vector<std::unique_ptr<XSpace>> xspaces;
   // prepare host 1.
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "xprof/convert/step_events_to_steps_db.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 #include <sstream>
@@ -30,6 +32,7 @@ limitations under the License.
 #include "xla/tsl/platform/types.h"
 #include "xla/tsl/profiler/utils/timespan.h"
 #include "xprof/convert/op_metrics_db_combiner.h"
+#include "xprof/convert/xprof_thread_pool_executor.h"
 #include "plugin/xprof/protobuf/steps_db.pb.h"
 #include "xprof/utils/event_span.h"
 #include "xprof/utils/op_metrics_db_utils.h"
@@ -45,6 +48,9 @@ const uint32 kDefaultGpuLocalCoreId = 1;
 
 namespace {
 
+// Number of steps converted by one task of the thread pool.
+constexpr size_t kNumStepsPerChunk = 256;
+
 void StepEventsToPerCoreStepInfo(uint32_t step_num, StepDetails& step_details,
                                  PerCoreStepInfo& per_core_step_info) {
   per_core_step_info.set_step_num(step_num);
@@ -157,6 +163,45 @@ string DebugStepInfo(const StepInfoResult& step_info) {
   return out.str();
 }
 
+// Converts the events of a single step into `per_core_step_info`. Returns false
+// if the step is not well-formed and should be left out of the step database.
+bool ConvertStepDetailsToPerCoreStepInfo(bool has_device, int64_t step,
+                                         StepDetails& step_details,
+                                         PerCoreStepInfo& per_core_step_info) {
+  per_core_step_info.set_step_num(step);
+  if (!step_details.PerCoreOpMetricsDb().empty()) {
+    StepEventsToPerCoreStepInfo(step, step_details, per_core_step_info);
+    return true;
+  }
+  StepInfoResult step_info =
+      ConvertStepDetailsToStepInfo(has_device, step, step_details);
+  if (step_info.duration_ps() == 0)
+    return false;  // Do not include non-well-formed steps.
+  // When we generated StepEvents, we already put events from all device
+  // cores and cpu threads on this host into a single event stream,
+  // therefore we can't separate them anymore. Simply assigns all events to
+  // Core-0.
+  (*per_core_step_info.mutable_step_info_per_core())[kDefaultGpuLocalCoreId] =
+      std::move(step_info);
+  VLOG(2) << std::endl
+          << "step_id: " << step << ", step_info:" << std::endl
+          << DebugStepInfo((*per_core_step_info.mutable_step_info_per_core())
+                               [kDefaultGpuLocalCoreId]);
+  // Populates the collective ops information.
+  auto& collectives = *per_core_step_info.mutable_all_reduce_db_per_core();
+  for (const auto& it : step_details.Collectives()) {
+    collectives[it.first] = it.second;
+  }
+  // Populates the device transfer stats for this step.
+  auto& device_memory_transfers =
+      *per_core_step_info.mutable_device_memory_transfers();
+  for (const auto& dma : step_details.DeviceMemoryTransfers()) {
+    *device_memory_transfers.Add() = dma;
+  }
+  // The remaining fields in PerCoreStepInfo are not filled.
+  return true;
+}
+
 }  // namespace
 
 StepDatabaseResult ConvertStepEventsToStepDb(
@@ -170,45 +215,42 @@ StepDatabaseResult ConvertStepEventsToStepDb(
     step_numbers.push_back(step_events.first);
   }
   absl::c_sort(step_numbers);
-  for (const auto& step : step_numbers) {
-    auto* step_details = tsl::gtl::FindOrNull(nonoverlapped_step_events, step);
-    if (step_details == nullptr) continue;
-    PerCoreStepInfo per_core_step_info;
-    per_core_step_info.set_step_num(step);
-    if (!step_details->PerCoreOpMetricsDb().empty()) {
-      StepEventsToPerCoreStepInfo(step, *step_details, per_core_step_info);
-    } else {
-      StepInfoResult step_info =
-          ConvertStepDetailsToStepInfo(has_device, step, *step_details);
-      if (step_info.duration_ps() == 0)
-        continue;  // Do not include non-well-formed steps.
-      // When we generated StepEvents, we already put events from all device
-      // cores and cpu threads on this host into a single event stream,
-      // therefore we can't separate them anymore. Simply assigns all events to
-      // Core-0.
-      (*per_core_step_info
-            .mutable_step_info_per_core())[kDefaultGpuLocalCoreId] =
-          std::move(step_info);
-      VLOG(2)
-          << std::endl
-          << "step_id: " << step << ", step_info:" << std::endl
-          << DebugStepInfo(
-                 (*per_core_step_info
-                       .mutable_step_info_per_core())[kDefaultGpuLocalCoreId]);
-      // Populates the collective ops information.
-      auto& collectives = *per_core_step_info.mutable_all_reduce_db_per_core();
-      for (const auto& it : step_details->Collectives()) {
-        collectives[it.first] = it.second;
-      }
-      // Populates the device transfer stats for this step.
-      auto& device_memory_transfers =
-          *per_core_step_info.mutable_device_memory_transfers();
-      for (const auto& dma : step_details->DeviceMemoryTransfers()) {
-        *device_memory_transfers.Add() = dma;
-      }
+
+  // Steps are independent of each other, so they are converted in chunks on a
+  // thread pool. Each chunk writes to its own slots, and the results are moved
+  // into the step database in step order afterwards.
+  const size_t num_steps = step_numbers.size();
+  std::vector<StepDetails*> step_details(num_steps);
+  for (size_t i = 0; i < num_steps; ++i) {
+    step_details[i] = &nonoverlapped_step_events[step_numbers[i]];
+  }
+  std::vector<PerCoreStepInfo> per_core_step_infos(num_steps);
+  // Not std::vector<bool>, whose packed bits cannot be written concurrently.
+  std::vector<char> well_formed(num_steps);
+  auto convert_steps = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      well_formed[i] = ConvertStepDetailsToPerCoreStepInfo(
+          has_device, step_numbers[i], *step_details[i],
+          per_core_step_infos[i]);
     }
-    // The remaining fields in PerCoreStepInfo are not filled.
-    *step_db.add_step_sequence() = per_core_step_info;
+  };
+  if (num_steps <= kNumStepsPerChunk) {
+    convert_steps(0, num_steps);
+  } else {
+    XprofThreadPoolExecutor executor("ConvertStepEventsToStepDb");
+    for (size_t begin = 0; begin < num_steps; begin += kNumStepsPerChunk) {
+      size_t end = std::min(begin + kNumStepsPerChunk, num_steps);
+      executor.Execute([&convert_steps, begin, end] {
+        convert_steps(begin, end);
+      });
+    }
+    executor.JoinAll();
+  }
+
+  step_db.mutable_step_sequence()->Reserve(num_steps);
+  for (size_t i = 0; i < num_steps; ++i) {
+    if (!well_formed[i]) continue;
+    *step_db.add_step_sequence() = std::move(per_core_step_infos[i]);
   }
 
   // If we are using sampling mode and we get enough steps, we would like to
@@ -0,0 +1,295 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "xprof/convert/trace_viewer/legacy_trace_to_json.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "xla/tsl/platform/errors.h"
+#include "xla/tsl/profiler/utils/timespan.h"
+#include "xprof/convert/trace_viewer/trace_events.h"
+#include "xprof/convert/trace_viewer/trace_events_to_json.h"
+#include "xprof/convert/trace_viewer/trace_viewer_color.h"
+#include "xprof/convert/trace_viewer/trace_viewer_visibility.h"
+#include "plugin/xprof/protobuf/trace_events.pb.h"
+#include "plugin/xprof/protobuf/trace_events_old.pb.h"
+#include "plugin/xprof/protobuf/trace_events_raw.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+void WriteMetadataEvents(const ::xprof::Trace& trace,
+                         JsonSeparator<IOBufferAdapter>* separator,
+                         IOBufferAdapter* output) {
+  std::map<uint64_t, const ::xprof::Device*> ordered_devices;
+  for (const auto& [device_id, device] : trace.devices()) {
+    ordered_devices.emplace(device_id, &device);
+  }
+  for (const auto& [device_id, device] : ordered_devices) {
+    if (!device->name().empty()) {
+      separator->Add();
+      output->Append(R"({"args":{"name":)", JsonEscape(device->name()),
+                     R"(},"name":"process_name","ph":"M","pid":)", device_id,
+                     "}");
+    }
+    separator->Add();
+    output->Append(R"({"args":{"sort_index":)", device_id,
+                   R"(},"name":"process_sort_index","ph":"M","pid":)",
+                   device_id, "}");
+    std::map<uint64_t, const ::xprof::Resource*> ordered_resources;
+    for (const auto& [resource_id, resource] : device->resources()) {
+      ordered_resources.emplace(resource_id, &resource);
+    }
+    for (const auto& [resource_id, resource] : ordered_resources) {
+      if (!resource->name().empty()) {
+        separator->Add();
+        output->Append(R"({"args":{"name":)", JsonEscape(resource->name()),
+                       R"(},"name":"thread_name","ph":"M","pid":)", device_id,
+                       R"(,"tid":)", resource_id, "}");
+      }
+      separator->Add();
+      output->Append(R"({"args":{"sort_index":)", resource_id,
+                     R"(},"name":"thread_sort_index","ph":"M","pid":)",
+                     device_id, R"(,"tid":)", resource_id, "}");
+    }
+  }
+}
+
+using LegacyEventArgs = std::vector<std::pair<absl::string_view,
+                                              absl::string_view>>;
+
+// Writes a zero-duration legacy event as a thread-scoped instant event. The
+// trace viewer shows these as markers; JsonEventWriter would widen them into
+// 1ps complete events instead.
+void WriteInstantEvent(const ::xprof::TraceEvent& event,
+                       const LegacyEventArgs& args, IOBufferAdapter* output) {
+  output->Append(R"({"pid":)", event.device_id(), R"(,"tid":)",
+                 event.resource_id(), R"(,"name":)", JsonEscape(event.name()));
+  absl::Format(output, R"(,"ts":%.17g)", PicosToMicros(event.timestamp_ps()));
+  output->Append(R"(,"ph":"i","s":"t")");
+  if (!args.empty()) {
+    output->Append(R"(,"args":{)");
+    JsonSeparator<IOBufferAdapter> separator(output);
+    for (const auto& [name, value] : args) {
+      separator.Add();
+      output->Append(JsonEscape(name), ":", JsonEscape(value));
+    }
+    output->Append("}");
+  }
+  output->Append("}");
+}
+
+// Returns the smallest zoom level at which each event of `trace` is visible,
+// following the same rules as GetEventsByLevel.
+std::vector<uint8_t> LegacyEventLevels(const ::xprof::Trace& trace) {
+  const auto& events = trace.trace_events();
+  uint64_t begin_ps = std::numeric_limits<uint64_t>::max();
+  uint64_t end_ps = 0;
+  for (const ::xprof::TraceEvent& event : events) {
+    begin_ps = std::min(begin_ps, event.timestamp_ps());
+    end_ps = std::max(end_ps, event.timestamp_ps() + event.duration_ps());
+  }
+  tsl::profiler::Timespan trace_span =
+      tsl::profiler::Timespan::FromEndPoints(begin_ps,
+                                             std::max(end_ps, begin_ps + 1));
+  std::vector<TraceViewerVisibility> visibility_by_level;
+  for (unsigned level = 0; LayerResolutionPs(level + 1) > 0; ++level) {
+    visibility_by_level.emplace_back(trace_span, LayerResolutionPs(level));
+  }
+
+  // Visibility must be evaluated in timestamp order, longest event first.
+  std::vector<int> order(events.size());
+  for (int i = 0; i < order.size(); ++i) order[i] = i;
+  absl::c_stable_sort(order, [&events](int a, int b) {
+    if (events[a].timestamp_ps() != events[b].timestamp_ps()) {
+      return events[a].timestamp_ps() < events[b].timestamp_ps();
+    }
+    return events[a].duration_ps() > events[b].duration_ps();
+  });
+
+  std::vector<uint8_t> levels(events.size());
+  TraceEvent event;  // Reused to avoid allocating per event.
+  for (int i : order) {
+    event.set_device_id(events[i].device_id());
+    event.set_resource_id(events[i].resource_id());
+    event.set_timestamp_ps(events[i].timestamp_ps());
+    event.set_duration_ps(events[i].duration_ps());
+    size_t level = 0;
+    for (; level < visibility_by_level.size(); ++level) {
+      if (visibility_by_level[level].VisibleAtResolution(event)) break;
+    }
+    levels[i] = level;
+    for (++level; level < visibility_by_level.size(); ++level) {
+      visibility_by_level[level].SetVisibleAtResolution(event);
+    }
+  }
+  return levels;
+}
+
+}  // namespace
+
+void MaybeDropLegacyTraceEvents(size_t max_events, ::xprof::Trace* trace) {
+  auto* events = trace->mutable_trace_events();
+  if (events->size() <= max_events) return;
+  std::vector<uint8_t> levels = LegacyEventLevels(*trace);
+
+  // Find the first level that does not fit and how many of its events do.
+  std::vector<size_t> events_per_level;
+  for (uint8_t level : levels) {
+    if (level >= events_per_level.size()) events_per_level.resize(level + 1);
+    ++events_per_level[level];
+  }
+  size_t last_level = 0;
+  size_t budget = max_events;
+  for (; last_level < events_per_level.size(); ++last_level) {
+    if (events_per_level[last_level] > budget) break;
+    budget -= events_per_level[last_level];
+  }
+
+  // Keep the earliest `budget` events of `last_level`: all events before
+  // `max_timestamp_ps` and as many ties at it as still fit.
+  std::vector<uint64_t> last_level_timestamps;
+  for (int i = 0; i < events->size(); ++i) {
+    if (levels[i] == last_level) {
+      last_level_timestamps.push_back((*events)[i].timestamp_ps());
+    }
+  }
+  uint64_t max_timestamp_ps = 0;
+  size_t num_ties = 0;
+  if (budget > 0) {
+    auto nth = last_level_timestamps.begin() + budget - 1;
+    std::nth_element(last_level_timestamps.begin(), nth,
+                     last_level_timestamps.end());
+    max_timestamp_ps = *nth;
+    num_ties = budget - std::count_if(last_level_timestamps.begin(), nth,
+                                      [max_timestamp_ps](uint64_t timestamp) {
+                                        return timestamp < max_timestamp_ps;
+                                      });
+  }
+
+  int kept = 0;
+  for (int i = 0; i < events->size(); ++i) {
+    bool keep = levels[i] < last_level;
+    if (levels[i] == last_level && budget > 0) {
+      uint64_t timestamp_ps = (*events)[i].timestamp_ps();
+      if (timestamp_ps < max_timestamp_ps) {
+        keep = true;
+      } else if (timestamp_ps == max_timestamp_ps && num_ties > 0) {
+        keep = true;
+        --num_ties;
+      }
+    }
+    if (keep) events->SwapElements(kept++, i);
+  }
+  events->DeleteSubrange(kept, events->size() - kept);
+}
+
+void LegacyTraceToJson(const ::xprof::Trace& trace, std::string* json) {
+  IOBufferAdapter output(json);
+  output.Append(
+      R"({"displayTimeUnit":"ns","metadata":{"highres-ticks":true},)",
+      R"("traceEvents":[)");
+  JsonSeparator<IOBufferAdapter> separator(&output);
+  WriteMetadataEvents(trace, &separator, &output);
+
+  // Legacy events carry no name or raw data tables, stack frames or colors.
+  Trace empty_trace;
+  std::map<uint64_t, uint64_t> references;
+  DefaultTraceEventsColorer colorer;
+  JsonEventWriter<IOBufferAdapter, RawData> writer(&colorer, empty_trace,
+                                                   references, &output);
+  // The event, its arguments and the sorted argument list are reused across
+  // events to avoid allocating per event.
+  TraceEvent event;
+  RawData raw_data;
+  LegacyEventArgs args;
+  for (const ::xprof::TraceEvent& legacy_event : trace.trace_events()) {
+    // Map iteration order is unspecified; sort the arguments by name so the
+    // output is deterministic.
+    args.assign(legacy_event.args().begin(), legacy_event.args().end());
+    absl::c_sort(args);
+    separator.Add();
+    if (legacy_event.duration_ps() == 0) {
+      WriteInstantEvent(legacy_event, args, &output);
+      continue;
+    }
+    event.Clear();
+    event.set_device_id(legacy_event.device_id());
+    event.set_resource_id(legacy_event.resource_id());
+    event.set_name(legacy_event.name());
+    event.set_timestamp_ps(legacy_event.timestamp_ps());
+    event.set_duration_ps(legacy_event.duration_ps());
+    if (!args.empty()) {
+      raw_data.Clear();
+      TraceEventArguments* arguments = raw_data.mutable_args();
+      for (const auto& [name, value] : args) {
+        TraceEventArguments::Argument* arg = arguments->add_arg();
+        arg->set_name(std::string(name));
+        arg->set_str_value(std::string(value));
+      }
+      raw_data.SerializeToString(event.mutable_raw_data());
+    }
+    writer.WriteEvent(event);
+  }
+  output.Append("]}");
+}
+
+absl::StatusOr<std::string> LegacyTraceToJson(
+    absl::string_view serialized_trace) {
+  ::xprof::Trace trace;
+  if (!trace.ParseFromArray(serialized_trace.data(), serialized_trace.size())) {
+    return tsl::errors::InvalidArgument("Failed to parse legacy trace proto.");
+  }
+  std::string json;
+  LegacyTraceToJson(trace, &json);
+  return json;
+}
+
+absl::StatusOr<size_t> CountLegacyTraceEvents(
+    absl::string_view serialized_trace) {
+  using ::google::protobuf::internal::WireFormatLite;
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t*>(serialized_trace.data()),
+      serialized_trace.size());
+  size_t num_events = 0;
+  while (uint32_t tag = input.ReadTag()) {
+    if (WireFormatLite::GetTagFieldNumber(tag) ==
+        ::xprof::Trace::kTraceEventsFieldNumber) {
+      ++num_events;
+    }
+    if (!WireFormatLite::SkipField(&input, tag)) break;
+  }
+  if (static_cast<size_t>(input.CurrentPosition()) !=
+      serialized_trace.size()) {
+    return tsl::errors::InvalidArgument("Failed to parse legacy trace proto.");
+  }
+  return num_events;
+}
+
+}  // namespace profiler
+}  // namespace tensorflow
@@ -0,0 +1,52 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef THIRD_PARTY_XPROF_CONVERT_TRACE_VIEWER_LEGACY_TRACE_TO_JSON_H_
+#define THIRD_PARTY_XPROF_CONVERT_TRACE_VIEWER_LEGACY_TRACE_TO_JSON_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "plugin/xprof/protobuf/trace_events_old.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+
+// Appends the trace-viewer JSON for a legacy Trace proto to `json`. Events are
+// written by JsonEventWriter in the order they appear in the proto, preceded by
+// the process and thread metadata events of all devices and resources.
+void LegacyTraceToJson(const ::xprof::Trace& trace, std::string* json);
+
+// Same as above, from a serialized legacy Trace proto.
+absl::StatusOr<std::string> LegacyTraceToJson(
+    absl::string_view serialized_trace);
+
+// Drops events from `trace` until at most `max_events` remain, keeping the
+// events that are visible at the coarsest zoom levels of the streaming trace
+// viewer. Whole zoom levels are kept from the coarsest one down; the first
+// level that does not fit is filled in timestamp order. The kept events stay
+// in their original order.
+void MaybeDropLegacyTraceEvents(size_t max_events, ::xprof::Trace* trace);
+
+// Returns the number of events in a serialized legacy Trace proto. Only the
+// field tags are read, so this is much cheaper than parsing the trace.
+absl::StatusOr<size_t> CountLegacyTraceEvents(
+    absl::string_view serialized_trace);
+
+}  // namespace profiler
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_XPROF_CONVERT_TRACE_VIEWER_LEGACY_TRACE_TO_JSON_H_
@@ -0,0 +1,126 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "xprof/convert/trace_viewer/legacy_trace_to_json.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "<gtest/gtest.h>"
+#include "plugin/xprof/protobuf/trace_events_old.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+TEST(LegacyTraceToJsonTest, WritesMetadataAndEvents) {
+  ::xprof::Trace trace;
+  ::xprof::Device& device_2 = (*trace.mutable_devices())[2];
+  device_2.set_name("D2");
+  device_2.set_device_id(2);
+  (*device_2.mutable_resources())[2].set_name("R2.2");
+  ::xprof::Device& device_1 = (*trace.mutable_devices())[1];
+  device_1.set_name("D1");
+  device_1.set_device_id(1);
+  (*device_1.mutable_resources())[2].set_name("R1.2");
+
+  ::xprof::TraceEvent* event = trace.add_trace_events();
+  event->set_device_id(1);
+  event->set_resource_id(2);
+  event->set_name("E1.2.1");
+  event->set_timestamp_ps(100000);
+  event->set_duration_ps(10000);
+  (*event->mutable_args())["label"] = "E1.2.1";
+  (*event->mutable_args())["extra"] = "extra info";
+  event = trace.add_trace_events();
+  event->set_device_id(2);
+  event->set_resource_id(2);
+  event->set_name("E2.2.1");
+  event->set_timestamp_ps(105000);
+  (*event->mutable_args())["label"] = "E2.2.1";
+
+  std::string json;
+  LegacyTraceToJson(trace, &json);
+  EXPECT_EQ(
+      json,
+      R"({"displayTimeUnit":"ns","metadata":{"highres-ticks":true},)"
+      R"("traceEvents":[)"
+      R"({"args":{"name":"D1"},"name":"process_name","ph":"M","pid":1},)"
+      R"({"args":{"sort_index":1},"name":"process_sort_index","ph":"M","pid":1},)"
+      R"({"args":{"name":"R1.2"},"name":"thread_name","ph":"M","pid":1,"tid":2},)"
+      R"({"args":{"sort_index":2},"name":"thread_sort_index","ph":"M","pid":1,"tid":2},)"
+      R"({"args":{"name":"D2"},"name":"process_name","ph":"M","pid":2},)"
+      R"({"args":{"sort_index":2},"name":"process_sort_index","ph":"M","pid":2},)"
+      R"({"args":{"name":"R2.2"},"name":"thread_name","ph":"M","pid":2,"tid":2},)"
+      R"({"args":{"sort_index":2},"name":"thread_sort_index","ph":"M","pid":2,"tid":2},)"
+      R"({"pid":1,"tid":2,"name":"E1.2.1","ts":0.10000000000000001,)"
+      R"("dur":0.01,"ph":"X","args":{"extra":"extra info","label":"E1.2.1"}},)"
+      R"({"pid":2,"tid":2,"name":"E2.2.1","ts":0.105,"ph":"i","s":"t",)"
+      R"("args":{"label":"E2.2.1"}}]})");
+}
+
+TEST(LegacyTraceToJsonTest, InvalidProtoIsAnError) {
+  EXPECT_FALSE(LegacyTraceToJson("not a proto").ok());
+}
+
+TEST(CountLegacyTraceEventsTest, CountsEventsWithoutParsing) {
+  ::xprof::Trace trace;
+  ::xprof::Device& device = (*trace.mutable_devices())[1];
+  device.set_name("D1");
+  (*device.mutable_resources())[1].set_name("R1.1");
+  for (int i = 0; i < 3; ++i) {
+    ::xprof::TraceEvent* event = trace.add_trace_events();
+    event->set_name("op");
+    event->set_timestamp_ps(i * 1000);
+  }
+  EXPECT_EQ(CountLegacyTraceEvents(trace.SerializeAsString()).value(), 3);
+  EXPECT_EQ(CountLegacyTraceEvents("").value(), 0);
+  EXPECT_FALSE(CountLegacyTraceEvents("not a proto").ok());
+}
+
+TEST(MaybeDropLegacyTraceEventsTest, KeepsCoarseZoomLevelsFirst) {
+  ::xprof::Trace trace;
+  auto add_event = [&trace](const char* name, uint64_t timestamp_ps,
+                            uint64_t duration_ps) {
+    ::xprof::TraceEvent* event = trace.add_trace_events();
+    event->set_device_id(1);
+    event->set_resource_id(1);
+    event->set_name(name);
+    event->set_timestamp_ps(timestamp_ps);
+    event->set_duration_ps(duration_ps);
+  };
+  // A 10s step containing a 1ms op, followed by many back-to-back 1us ops.
+  add_event("op", 5000000000000, 1000000000);
+  add_event("step", 0, 10000000000000);
+  for (int i = 0; i < 10; ++i) {
+    add_event("tiny", 20000000000000 + i * 1000000, 1000000);
+  }
+
+  ::xprof::Trace unchanged = trace;
+  MaybeDropLegacyTraceEvents(12, &unchanged);
+  EXPECT_EQ(unchanged.trace_events_size(), 12);
+
+  MaybeDropLegacyTraceEvents(4, &trace);
+  std::vector<std::string> names;
+  for (const auto& event : trace.trace_events()) names.push_back(event.name());
+  EXPECT_EQ(names, std::vector<std::string>({"op", "step", "tiny", "tiny"}));
+  EXPECT_EQ(trace.trace_events(2).timestamp_ps(), 20000000000000);
+  EXPECT_EQ(trace.trace_events(3).timestamp_ps(), 20000001000000);
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
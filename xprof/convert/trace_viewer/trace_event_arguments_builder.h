@@ -54,6 +54,13 @@ class TraceEventArgumentsBuilder {
     arg->set_double_value(value);
   }
 
+  // Appends a string argument already interned in the trace's name table.
+  void AppendRef(absl::string_view key, uint64_t ref) {
+    auto* arg = args_->add_arg();
+    arg->set_name(key.data(), key.size());
+    arg->set_ref_value(ref);
+  }
+
  private:
   TraceEventArguments* args_;
 };
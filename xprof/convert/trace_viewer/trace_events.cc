@@ -16,21 +16,30 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/internal/endian.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xla/tsl/lib/io/cache.h"
 #include "xla/tsl/lib/io/iterator.h"
 #include "xla/tsl/lib/io/table.h"
 #include "xla/tsl/lib/io/table_builder.h"
@@ -39,11 +48,15 @@ limitations under the License.
 #include "xla/tsl/platform/errors.h"
 #include "xla/tsl/platform/file_system.h"
 #include "xla/tsl/platform/macros.h"
+#include "xla/tsl/platform/statusor.h"
 #include "xla/tsl/profiler/utils/timespan.h"
 #include "xla/tsl/platform/types.h"
+#include "tsl/platform/cpu_info.h"
 #include "xprof/convert/trace_viewer/trace_events_filter_interface.h"
 #include "xprof/convert/trace_viewer/trace_events_util.h"
+#include "xprof/convert/trace_viewer/trace_viewer_color.h"
 #include "xprof/convert/trace_viewer/trace_viewer_visibility.h"
+#include "xprof/convert/xprof_thread_pool_executor.h"
 #include "plugin/xprof/protobuf/trace_events.pb.h"
 #include "plugin/xprof/protobuf/trace_events_raw.pb.h"
 
@@ -89,6 +102,109 @@ uint64_t TimestampFromLevelDbTableKey(absl::string_view level_db_table_key) {
   return absl::big_endian::ToHost64(value);
 }
 
+// Upper bound on the memory used by the trace blocks cached across all open
+// LevelDB tables. Blocks are evicted in least-recently-used order.
+constexpr size_t kTraceTableBlockCacheBytes = size_t{1} << 30;
+
+// Maximum number of LevelDB tables kept open between requests. Each open table
+// holds its index block in memory.
+constexpr size_t kMaxOpenTraceTables = 16;
+
+// A LevelDB table together with the file it reads from. The table is declared
+// last so it is destroyed before the file.
+struct OpenTraceTable {
+  int64_t mtime_nsec = 0;
+  uint64_t file_size = 0;
+  std::unique_ptr<tsl::RandomAccessFile> file;
+  std::unique_ptr<tsl::table::Table> table;
+};
+
+// Keeps LevelDB tables open across requests, so that panning and zooming in the
+// trace viewer does not reopen the file and re-read its index, and shares one
+// block cache between them so recently read blocks are not decompressed again.
+// Tables are keyed by path and reopened when the file's mtime or size changes.
+class OpenTraceTableCache {
+ public:
+  static OpenTraceTableCache& Get() {
+    static OpenTraceTableCache* cache = new OpenTraceTableCache();
+    return *cache;
+  }
+
+  // Returns the open table for `filename`, opening it if needed. The returned
+  // table stays valid after it is evicted from the cache.
+  absl::StatusOr<std::shared_ptr<const OpenTraceTable>> GetOrOpen(
+      const std::string& filename) {
+    tsl::FileStatistics stat;
+    TF_RETURN_IF_ERROR(tsl::Env::Default()->Stat(filename, &stat));
+    {
+      absl::MutexLock lock(&mu_);
+      auto it = FindLocked(filename);
+      if (it != tables_.end() && it->second->mtime_nsec == stat.mtime_nsec &&
+          it->second->file_size == static_cast<uint64_t>(stat.length)) {
+        // Move the entry to the front, which holds the most recently used.
+        std::rotate(tables_.begin(), it, it + 1);
+        return tables_.front().second;
+      }
+    }
+    // Open outside of the lock; opening reads the table index from the file.
+    TF_ASSIGN_OR_RETURN(std::shared_ptr<const OpenTraceTable> table,
+                        Open(filename, stat));
+    absl::MutexLock lock(&mu_);
+    auto it = FindLocked(filename);
+    if (it != tables_.end()) tables_.erase(it);
+    tables_.emplace(tables_.begin(), filename, table);
+    if (tables_.size() > kMaxOpenTraceTables) tables_.pop_back();
+    return table;
+  }
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<const OpenTraceTable>>;
+
+  OpenTraceTableCache()
+      : block_cache_(tsl::table::NewLRUCache(kTraceTableBlockCacheBytes)) {}
+
+  std::vector<Entry>::iterator FindLocked(const std::string& filename)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return absl::c_find_if(
+        tables_, [&](const Entry& entry) { return entry.first == filename; });
+  }
+
+  absl::StatusOr<std::shared_ptr<const OpenTraceTable>> Open(
+      const std::string& filename, const tsl::FileStatistics& stat) {
+    tsl::FileSystem* file_system;
+    TF_RETURN_IF_ERROR(
+        tsl::Env::Default()->GetFileSystemForFile(filename, &file_system));
+
+    auto open_table = std::make_shared<OpenTraceTable>();
+    open_table->mtime_nsec = stat.mtime_nsec;
+    open_table->file_size = stat.length;
+    TF_RETURN_IF_ERROR(
+        file_system->NewRandomAccessFile(filename, &open_table->file));
+
+    tsl::table::Options options;
+    options.block_size = 20 * 1024 * 1024;
+    options.block_cache = block_cache_.get();
+    tsl::table::Table* table = nullptr;
+    TF_RETURN_IF_ERROR(tsl::table::Table::Open(options, open_table->file.get(),
+                                               open_table->file_size, &table));
+    open_table->table.reset(table);
+    return open_table;
+  }
+
+  const std::unique_ptr<tsl::table::Cache> block_cache_;
+  absl::Mutex mu_;
+  // Most recently used first. The cache is small, so a linear scan is enough.
+  std::vector<Entry> tables_ ABSL_GUARDED_BY(mu_);
+};
+
+// Returns the layout of `zoom_level`.
+TraceTableOptions::Level TraceTableLevel(const TraceTableOptions& options,
+                                         int zoom_level) {
+  if (options.levels.empty()) return TraceTableOptions::Level();
+  return options.levels[std::min<size_t>(zoom_level,
+                                         options.levels.size() - 1)];
+}
+
 bool ReadTraceMetadata(tsl::table::Iterator* iterator,
                        absl::string_view metadata_key, Trace* trace) {
   if (!iterator->Valid()) return false;
@@ -99,9 +215,9 @@ bool ReadTraceMetadata(tsl::table::Iterator* iterator,
 }
 
 // Returns the total number of events.
-inline int32_t NumEvents(
+inline size_t NumEvents(
     const std::vector<const TraceEventTrack*>& event_tracks) {
-  int32_t num_events = 0;
+  size_t num_events = 0;
   for (const auto* track : event_tracks) {
     num_events += track->size();
   }
@@ -125,8 +241,189 @@ void MaybeAddEventUniqueId(std::vector<TraceEvent*>& events) {
   }
 }
 
+// Below this number of events, MergeEventTracks does a single-threaded
+// n-way merge; the cost of partitioning is not worth it.
+constexpr size_t kMinEventsForParallelMerge = 1 << 16;
+
+// Number of samples taken per partition when choosing the partition splitters.
+// Oversampling makes the partitions more balanced.
+constexpr size_t kMergeOversampling = 32;
+
+// An event identified by its track and its position in the track.
+struct TrackPosition {
+  size_t track;
+  size_t index;
+};
+
+// Orders events by TraceEventsComparator, and events that compare equal by
+// track index and then by position in the track. This is a total order, so
+// the merged order does not depend on how the tracks are partitioned.
+bool TrackPositionLess(const TraceEvent* a, TrackPosition a_position,
+                       const TraceEvent* b, TrackPosition b_position) {
+  TraceEventsComparator cmp;
+  if (cmp(a, b)) return true;
+  if (cmp(b, a)) return false;
+  return std::tie(a_position.track, a_position.index) <
+         std::tie(b_position.track, b_position.index);
+}
+
+using TrackSlice = absl::Span<TraceEvent* const>;
+
+// Merges the sorted slices into `out`. slices[t] must be a part of track t.
+// Events that compare equal are taken from the lowest track first.
+void MergeTrackSlices(const std::vector<TrackSlice>& slices, TraceEvent** out) {
+  struct Source {
+    TrackSlice::const_iterator next;
+    TrackSlice::const_iterator end;
+    size_t track;
+  };
+  std::vector<Source> sources;
+  for (size_t t = 0; t < slices.size(); ++t) {
+    if (!slices[t].empty()) {
+      sources.push_back({slices[t].begin(), slices[t].end(), t});
+    }
+  }
+  if (sources.empty()) return;
+  // Inverted so as to produce a min-heap. Within a track events are already
+  // in order, so only the track index is needed to break ties.
+  auto heap_cmp = [](const Source& a, const Source& b) {
+    TraceEventsComparator cmp;
+    if (cmp(*b.next, *a.next)) return true;
+    if (cmp(*a.next, *b.next)) return false;
+    return b.track < a.track;
+  };
+  std::make_heap(sources.begin(), sources.end(), heap_cmp);
+  while (true) {
+    Source& source = sources.front();
+    *out++ = *source.next++;
+    if (source.next == source.end) {
+      if (sources.size() == 1) return;
+      source = sources.back();
+      sources.pop_back();
+    }
+    push_down_root(sources.begin(), sources.end(), heap_cmp);
+  }
+}
+
+// Chooses up to `num_partitions - 1` splitter events that divide the events in
+// all tracks into slices of roughly equal size. Samples are taken at a fixed
+// stride over the concatenation of all tracks, so larger tracks contribute
+// proportionally more samples.
+std::vector<TrackPosition> ChooseMergeSplitters(
+    const std::vector<const TraceEventTrack*>& event_tracks, size_t num_events,
+    size_t num_partitions) {
+  size_t stride =
+      std::max<size_t>(1, num_events / (num_partitions * kMergeOversampling));
+  std::vector<TrackPosition> samples;
+  samples.reserve(num_events / stride + event_tracks.size());
+  size_t offset = 0;  // Index of the next sample within the current track.
+  for (size_t t = 0; t < event_tracks.size(); ++t) {
+    for (; offset < event_tracks[t]->size(); offset += stride) {
+      samples.push_back({t, offset});
+    }
+    offset -= event_tracks[t]->size();
+  }
+  auto event = [&event_tracks](TrackPosition position) {
+    return (*event_tracks[position.track])[position.index];
+  };
+  absl::c_sort(samples, [&event](TrackPosition a, TrackPosition b) {
+    return TrackPositionLess(event(a), a, event(b), b);
+  });
+  std::vector<TrackPosition> splitters;
+  splitters.reserve(num_partitions - 1);
+  for (size_t i = 1; i < num_partitions; ++i) {
+    splitters.push_back(samples[i * samples.size() / num_partitions]);
+  }
+  return splitters;
+}
+
+// Returns the executor used by ParallelMergeEventTracks. It is shared by all
+// calls, so its threads are created only once.
+XprofThreadPoolExecutor& MergeExecutor() {
+  static XprofThreadPoolExecutor* executor =
+      new XprofThreadPoolExecutor("merge_event_tracks");
+  return *executor;
+}
+
+// Merges the tracks by splitting them at the given splitters, merging each
+// slice concurrently and writing it at its offset in `events`. Splitting and
+// merging use the same total order (see TrackPositionLess), so the result is
+// exactly the order of a single merge of all tracks.
+void ParallelMergeEventTracks(
+    const std::vector<const TraceEventTrack*>& event_tracks,
+    const std::vector<TrackPosition>& splitters,
+    std::vector<TraceEvent*>& events) {
+  const size_t num_partitions = splitters.size() + 1;
+  // slices[p][t] is the part of track t that falls in partition p.
+  std::vector<std::vector<TrackSlice>> slices(num_partitions);
+  std::vector<size_t> partition_offsets(num_partitions + 1, 0);
+  for (auto& partition : slices) partition.reserve(event_tracks.size());
+  for (size_t t = 0; t < event_tracks.size(); ++t) {
+    const TraceEventTrack& track = *event_tracks[t];
+    size_t begin = 0;
+    for (size_t p = 0; p < num_partitions; ++p) {
+      size_t end = track.size();
+      if (p < splitters.size()) {
+        // Find the first event of the track ordered after the splitter.
+        const TrackPosition& splitter = splitters[p];
+        const TraceEvent* splitter_event =
+            (*event_tracks[splitter.track])[splitter.index];
+        size_t lo = begin;
+        while (lo < end) {
+          size_t mid = lo + (end - lo) / 2;
+          if (TrackPositionLess(splitter_event, splitter, track[mid],
+                                {t, mid})) {
+            end = mid;
+          } else {
+            lo = mid + 1;
+          }
+        }
+      }
+      slices[p].emplace_back(track.data() + begin, end - begin);
+      partition_offsets[p + 1] += end - begin;
+      begin = end;
+    }
+  }
+  for (size_t p = 0; p < num_partitions; ++p) {
+    partition_offsets[p + 1] += partition_offsets[p];
+  }
+  events.resize(partition_offsets.back());
+
+  absl::BlockingCounter pending(num_partitions);
+  for (size_t p = 0; p < num_partitions; ++p) {
+    MergeExecutor().Execute([&slices, &events, &partition_offsets, &pending,
+                             p]() {
+      MergeTrackSlices(slices[p], events.data() + partition_offsets[p]);
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+}
+
 }  // namespace
 
+void ResourceEventsStore::SortByResourceId() {
+  if (sorted_) return;
+  std::vector<uint32_t> order(tracks_.size());
+  for (uint32_t slot = 0; slot < order.size(); ++slot) order[slot] = slot;
+  absl::c_sort(order, [this](uint32_t a, uint32_t b) {
+    return tracks_[a].first < tracks_[b].first;
+  });
+  std::vector<value_type> tracks;
+  std::vector<tsl::profiler::Timespan> active_spans;
+  tracks.reserve(tracks_.size());
+  active_spans.reserve(active_spans_.size());
+  for (uint32_t slot : order) {
+    slot_by_resource_id_[tracks_[slot].first] = tracks.size();
+    tracks.push_back(std::move(tracks_[slot]));
+    active_spans.push_back(active_spans_[slot]);
+  }
+  tracks_ = std::move(tracks);
+  active_spans_ = std::move(active_spans);
+  last_slot_ = kNoSlot;
+  sorted_ = true;
+}
+
 uint64_t LayerResolutionPs(unsigned level) {
   // This sometimes gets called in a tight loop, so levels are precomputed.
   return level >= NumLevels() ? 0 : kLayerResolutions[level];
@@ -148,8 +445,20 @@ std::pair<uint64_t, uint64_t> GetLevelBoundsForDuration(uint64_t duration_ps) {
 std::vector<TraceEvent*> MergeEventTracks(
     const std::vector<const TraceEventTrack*>& event_tracks) {
   std::vector<TraceEvent*> events;
-  events.reserve(NumEvents(event_tracks));
-  nway_merge(event_tracks, std::back_inserter(events), TraceEventsComparator());
+  size_t num_events = NumEvents(event_tracks);
+  size_t num_partitions = std::min<size_t>(
+      tsl::port::MaxParallelism(), num_events / kMinEventsForParallelMerge);
+  if (event_tracks.size() < 2 || num_partitions < 2) {
+    std::vector<TrackSlice> slices;
+    slices.reserve(event_tracks.size());
+    for (const auto* track : event_tracks) slices.emplace_back(*track);
+    events.resize(num_events);
+    MergeTrackSlices(slices, events.data());
+    return events;
+  }
+  ParallelMergeEventTracks(
+      event_tracks,
+      ChooseMergeSplitters(event_tracks, num_events, num_partitions), events);
   return events;
 }
 
@@ -188,24 +497,9 @@ std::vector<std::vector<const TraceEvent*>> GetEventsByLevel(
 
 absl::Status ReadFileTraceMetadata(std::string& filepath, Trace* trace) {
   // 1. Open the file.
-  uint64_t file_size;
-  TF_RETURN_IF_ERROR(tsl::Env::Default()->GetFileSize(filepath, &file_size));
-
-  tsl::FileSystem* file_system;
-  TF_RETURN_IF_ERROR(
-      tsl::Env::Default()->GetFileSystemForFile(filepath, &file_system));
-
-  std::unique_ptr<tsl::RandomAccessFile> file;
-  TF_RETURN_IF_ERROR(file_system->NewRandomAccessFile(filepath, &file));
-
-  tsl::table::Options options;
-  options.block_size = 20 * 1024 * 1024;
-  tsl::table::Table* table = nullptr;
-  TF_RETURN_IF_ERROR(
-      tsl::table::Table::Open(options, file.get(), file_size, &table));
-  std::unique_ptr<tsl::table::Table> table_deleter(table);
-
-  std::unique_ptr<tsl::table::Iterator> iterator(table->NewIterator());
+  TF_ASSIGN_OR_RETURN(std::shared_ptr<const OpenTraceTable> table,
+                      OpenTraceTableCache::Get().GetOrOpen(filepath));
+  std::unique_ptr<tsl::table::Iterator> iterator(table->table->NewIterator());
   if (iterator == nullptr) return absl::UnknownError("Could not open table");
 
   // 2. Read the metadata.
@@ -230,16 +524,40 @@ absl::Status ReadFileTraceMetadata(std::string& filepath, Trace* trace) {
 // eligible for.
 absl::Status DoStoreAsLevelDbTable(
     std::unique_ptr<tsl::WritableFile>& file, const Trace& trace,
-    const std::vector<std::vector<const TraceEvent*>>& events_by_level) {
+    const std::vector<std::vector<const TraceEvent*>>& events_by_level,
+    TraceEventsColorerInterface* colorer,
+    const TraceTableOptions& table_options) {
+  // The builder cuts blocks at the largest block size; levels with smaller
+  // blocks and time tiles are cut explicitly below.
   tsl::table::Options options;
-  options.block_size = 20 * 1024 * 1024;
-  options.compression = tsl::table::kSnappyCompression;
+  options.block_size = TraceTableLevel(table_options, 0).block_size;
+  for (int zoom_level = 1; zoom_level < events_by_level.size(); ++zoom_level) {
+    options.block_size =
+        std::max(options.block_size,
+                 TraceTableLevel(table_options, zoom_level).block_size);
+  }
+  options.compression = table_options.compression;
   tsl::table::TableBuilder builder(options, file.get());
 
-  builder.Add(kTraceMetadataKey, trace.SerializeAsString());
+  if (colorer != nullptr) {
+    colorer->SetUp(trace);
+    Trace colored_trace = trace;
+    colored_trace.set_colors_precomputed(true);
+    builder.Add(kTraceMetadataKey, colored_trace.SerializeAsString());
+  } else {
+    builder.Add(kTraceMetadataKey, trace.SerializeAsString());
+  }
 
   size_t num_of_events_dropped = 0;  // Due to too many timestamp repetitions.
   for (int zoom_level = 0; zoom_level < events_by_level.size(); ++zoom_level) {
+    // Start every level in a new block, so reading a level does not decompress
+    // the tail of the previous one.
+    builder.Flush();
+    const TraceTableOptions::Level level =
+        TraceTableLevel(table_options, zoom_level);
+    const bool cut_by_size = level.block_size < options.block_size;
+    size_t block_bytes = 0;
+    uint64_t tile = 0;
     // The key of level db table have to be monotonically increasing, therefore
     // we make the timestamp repetition count as the last byte of key as tie
     // breaker. The hidden assumption was that there are not too many identical
@@ -262,7 +580,22 @@ absl::Status DoStoreAsLevelDbTable(
         // redundant info because the timestamp is part of the key.
         TraceEvent event_copy = *event;
         event_copy.clear_timestamp_ps();
-        builder.Add(key, event_copy.SerializeAsString());
+        if (colorer != nullptr) {
+          if (std::optional<uint32_t> color_id = colorer->GetColor(*event)) {
+            event_copy.set_color_id(*color_id);
+          }
+        }
+        std::string value = event_copy.SerializeAsString();
+        uint64_t event_tile = level.tile_ps > 0 ? timestamp / level.tile_ps : 0;
+        if (block_bytes > 0 &&
+            ((cut_by_size && block_bytes >= level.block_size) ||
+             event_tile != tile)) {
+          builder.Flush();
+          block_bytes = 0;
+        }
+        tile = event_tile;
+        block_bytes += key.size() + value.size();
+        builder.Add(key, value);
       } else {
         ++num_of_events_dropped;
       }
@@ -286,23 +619,9 @@ absl::Status DoLoadFromLevelDbTable(
     bool& filter_by_visibility,
     const std::function<TraceEvent*(const TraceEvent&)>& copy_event_to_arena,
     const std::function<void(TraceEvent*)>& add_arena_event) {
-  uint64_t file_size;
-  TF_RETURN_IF_ERROR(tsl::Env::Default()->GetFileSize(filename, &file_size));
-
-  tsl::FileSystem* file_system;
-  TF_RETURN_IF_ERROR(
-      tsl::Env::Default()->GetFileSystemForFile(filename, &file_system));
-
-  std::unique_ptr<tsl::RandomAccessFile> file;
-  TF_RETURN_IF_ERROR(file_system->NewRandomAccessFile(filename, &file));
-
-  tsl::table::Options options;
-  options.block_size = 20 * 1024 * 1024;
-  tsl::table::Table* table = nullptr;
-  TF_RETURN_IF_ERROR(
-      tsl::table::Table::Open(options, file.get(), file_size, &table));
-  std::unique_ptr<tsl::table::Table> table_deleter(table);
-  std::unique_ptr<tsl::table::Iterator> iterator(table->NewIterator());
+  TF_ASSIGN_OR_RETURN(std::shared_ptr<const OpenTraceTable> table,
+                      OpenTraceTableCache::Get().GetOrOpen(filename));
+  std::unique_ptr<tsl::table::Iterator> iterator(table->table->NewIterator());
   if (iterator == nullptr) return tsl::errors::Unknown("Could not open table");
 
   // Read the metadata.
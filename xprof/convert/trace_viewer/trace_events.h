@@ -34,11 +34,13 @@ limitations under the License.
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "xla/tsl/lib/io/table_options.h"
 #include "xla/tsl/platform/file_system.h"
 #include "xla/tsl/profiler/utils/timespan.h"
 #include "tsl/profiler/lib/context_types.h"
 #include "xprof/convert/trace_viewer/trace_events_filter_interface.h"
 #include "xprof/convert/trace_viewer/trace_events_util.h"
+#include "xprof/convert/trace_viewer/trace_viewer_color.h"
 #include "xprof/convert/trace_viewer/trace_viewer_visibility.h"
 #include "plugin/xprof/protobuf/task.pb.h"
 #include "plugin/xprof/protobuf/trace_events.pb.h"
@@ -49,13 +51,38 @@ namespace profiler {
 // A track of events in the trace-viewer.
 using TraceEventTrack = std::vector<TraceEvent*>;
 
-// Merge-sorts the given event tracks. Each track must be sorted.
+// Merge-sorts the given event tracks. Each track must be sorted. Events that
+// compare equal are ordered by track index, so the result is deterministic.
 std::vector<TraceEvent*> MergeEventTracks(
     const std::vector<const TraceEventTrack*>& event_tracks);
 
+// Layout of the LevelDB table written by DoStoreAsLevelDbTable. A query only
+// decompresses the data blocks overlapping its viewport, so smaller blocks for
+// the fine-grained zoom levels reduce the bytes read per query.
+struct TraceTableOptions {
+  // Layout of the data blocks of one zoom level.
+  struct Level {
+    // Target size in bytes of the uncompressed data blocks.
+    size_t block_size = 20 * 1024 * 1024;
+    // If non-zero, blocks are aligned to time tiles of this width: a block
+    // never holds events from two different tiles.
+    uint64_t tile_ps = 0;
+  };
+
+  // Layout of each zoom level, starting at level 0. Levels past the end use
+  // the last entry, and all levels use the defaults if this is empty.
+  std::vector<Level> levels;
+  tsl::table::CompressionType compression = tsl::table::kSnappyCompression;
+};
+
+// If `colorer` is not null, the color of each event is computed once and
+// stored in TraceEvent.color_id, and the trace is marked as
+// colors_precomputed.
 absl::Status DoStoreAsLevelDbTable(
     std::unique_ptr<tsl::WritableFile>& file, const Trace& trace,
-    const std::vector<std::vector<const TraceEvent*>>& events_by_level);
+    const std::vector<std::vector<const TraceEvent*>>& events_by_level,
+    TraceEventsColorerInterface* colorer = nullptr,
+    const TraceTableOptions& table_options = TraceTableOptions());
 
 absl::Status DoLoadFromLevelDbTable(
     const std::string& filename,
@@ -79,6 +106,86 @@ uint64_t LayerResolutionPs(unsigned level);
 // with `duration_ps` would go into. (upper >= duration_ps > lower)
 std::pair<uint64_t, uint64_t> GetLevelBoundsForDuration(uint64_t duration_ps);
 
+// Event tracks of the resources of one device, stored contiguously in a
+// vector. Each resource_id is assigned a dense slot on first use, so adding an
+// event is a hash lookup (or none, for consecutive events on one resource) and
+// iteration walks a vector even with tens of thousands of short-lived host
+// threads. The time span covered by each track is kept as an activity index,
+// so windowed queries skip inactive resources without touching their events.
+// Iteration is in slot order, which is resource_id order once
+// SortByResourceId() has been called.
+class ResourceEventsStore {
+ public:
+  using value_type = std::pair<uint32_t /*resource_id*/, TraceEventTrack>;
+  using iterator = std::vector<value_type>::iterator;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  // Appends an event to the track of its resource.
+  void Add(TraceEvent* event) {
+    uint32_t slot = Slot(event->resource_id());
+    TraceEventTrack& events = tracks_[slot].second;
+    if (events.empty()) {
+      active_spans_[slot] = EventSpan(*event);
+    } else {
+      active_spans_[slot].ExpandToInclude(EventSpan(*event));
+    }
+    events.push_back(event);
+  }
+
+  // Calls 'callback' with the resource_id and events of each non-empty track
+  // that is active during `span`.
+  template <typename Callback>
+  void ForEachActiveTrack(const tsl::profiler::Timespan& span,
+                          Callback callback) const {
+    for (size_t slot = 0; slot < tracks_.size(); ++slot) {
+      const auto& [resource_id, events] = tracks_[slot];
+      if (events.empty() || !active_spans_[slot].Overlaps(span)) continue;
+      callback(resource_id, events);
+    }
+  }
+
+  // Reorders the slots by resource_id, if resources were not added in order.
+  // Call once all events have been added, so readers never reorder the slots.
+  void SortByResourceId();
+
+  size_t size() const { return tracks_.size(); }
+
+  iterator begin() { return tracks_.begin(); }
+  iterator end() { return tracks_.end(); }
+  const_iterator begin() const { return tracks_.begin(); }
+  const_iterator end() const { return tracks_.end(); }
+
+ private:
+  static constexpr uint32_t kNoSlot = ~0u;
+
+  // Returns the slot of the given resource, creating it if needed.
+  uint32_t Slot(uint32_t resource_id) {
+    if (resource_id == last_resource_id_ && last_slot_ != kNoSlot) {
+      return last_slot_;
+    }
+    auto [it, inserted] =
+        slot_by_resource_id_.try_emplace(resource_id, tracks_.size());
+    if (inserted) {
+      sorted_ = sorted_ &&
+                (tracks_.empty() || tracks_.back().first < resource_id);
+      tracks_.emplace_back(resource_id, TraceEventTrack());
+      active_spans_.emplace_back();
+    }
+    last_resource_id_ = resource_id;
+    last_slot_ = it->second;
+    return last_slot_;
+  }
+
+  std::vector<value_type> tracks_;
+  std::vector<tsl::profiler::Timespan> active_spans_;
+  absl::flat_hash_map<uint32_t /*resource_id*/, uint32_t /*slot*/>
+      slot_by_resource_id_;
+  bool sorted_ = true;
+  // Cache of the last lookup in Slot().
+  uint32_t last_resource_id_ = 0;
+  uint32_t last_slot_ = kNoSlot;
+};
+
 struct EventFactory {
   TraceEvent* Create() {
     events.push_back(std::make_unique<TraceEvent>());
@@ -93,10 +200,21 @@ struct DefaultStdHash {
   }
 };
 
+// Name of a trace event, given either as a string or as a reference to a name
+// already interned with TraceEventsContainerBase::MaybeInternName.
+using TraceEventName = std::variant<absl::string_view, uint64_t /*name_ref*/>;
+
 template <typename EventFactory, typename RawData,
           typename Hash = DefaultStdHash>
 class TraceEventsContainerBase {
  public:
+  // String arguments longer than this are interned in the trace's name table.
+  static constexpr size_t kTraceArgInternThreshold = 16;
+  // Upper bound on the bytes of the trace's raw_data_table. The table is part
+  // of the trace metadata, which is read on every streaming request, so
+  // argument sets past this bound stay inline in their events.
+  static constexpr size_t kRawDataTableMaxBytes = 1 << 20;
+
   TraceEventsContainerBase() {
     arenas_.insert(std::make_shared<EventFactory>());
   }
@@ -108,7 +226,7 @@ class TraceEventsContainerBase {
   TraceEventsContainerBase& operator=(const TraceEventsContainerBase&) = delete;
 
   // Creates a TraceEvent prefilled with the given values.
-  void AddCompleteEvent(absl::string_view name, uint32_t resource_id,
+  void AddCompleteEvent(TraceEventName name, uint32_t resource_id,
                         uint32_t device_id, tsl::profiler::Timespan timespan,
                         RawData* raw_data = nullptr,
                         std::optional<int64_t> group_id = std::nullopt,
@@ -122,9 +240,7 @@ class TraceEventsContainerBase {
       event->set_duration_ps(timespan.duration_ps());
     }
     if (raw_data) {
-      MaybeInternTraceArgument(raw_data);
-      raw_data->SerializePartialToString(event->mutable_raw_data());
-      if (event->raw_data().empty()) event->clear_raw_data();
+      MaybeInternRawData(event, raw_data);
     }
     if (group_id) {
       event->set_group_id(*group_id);
@@ -137,7 +253,7 @@ class TraceEventsContainerBase {
 
   // Similar to above, but the TraceEvent also has an associated flow_id and
   // flow_entry_type, to make it part of a flow.
-  void AddFlowEvent(absl::string_view name, uint32_t resource_id,
+  void AddFlowEvent(TraceEventName name, uint32_t resource_id,
                     uint32_t device_id, tsl::profiler::Timespan timespan,
                     uint64_t flow_id, TraceEvent::FlowEntryType flow_entry_type,
                     tsl::profiler::ContextType flow_category =
@@ -157,9 +273,7 @@ class TraceEventsContainerBase {
     event->set_flow_entry_type(flow_entry_type);
     event->set_flow_category(static_cast<uint32_t>(flow_category));
     if (raw_data) {
-      MaybeInternTraceArgument(raw_data);
-      raw_data->SerializePartialToString(event->mutable_raw_data());
-      if (event->raw_data().empty()) event->clear_raw_data();
+      MaybeInternRawData(event, raw_data);
     }
     if (group_id) {
       event->set_group_id(*group_id);
@@ -174,7 +288,7 @@ class TraceEventsContainerBase {
   // name is used as "async channel" which are used as "thread" name. It has an
   // associated unique flow_id and flow_entry_type to signal asynchronous
   // start and end events and match up between them.
-  void AddAsyncEvent(absl::string_view name, uint32_t device_id,
+  void AddAsyncEvent(TraceEventName name, uint32_t device_id,
                      tsl::profiler::Timespan timespan, uint64_t flow_id,
                      TraceEvent::FlowEntryType flow_entry_type,
                      tsl::profiler::ContextType flow_category =
@@ -193,9 +307,7 @@ class TraceEventsContainerBase {
     event->set_flow_entry_type(flow_entry_type);
     event->set_flow_category(static_cast<uint32_t>(flow_category));
     if (raw_data) {
-      MaybeInternTraceArgument(raw_data);
-      raw_data->SerializePartialToString(event->mutable_raw_data());
-      if (event->raw_data().empty()) event->clear_raw_data();
+      MaybeInternRawData(event, raw_data);
     }
     if (group_id) {
       event->set_group_id(*group_id);
@@ -227,6 +339,22 @@ class TraceEventsContainerBase {
     AddArenaEvent(event);
   }
 
+  // Interns `name` in the trace's name table and returns its reference. The
+  // reference can be used as a ref_value argument, so strings shared by many
+  // events are hashed once.
+  uint64_t InternString(absl::string_view name) {
+    return MaybeInternString(name);
+  }
+
+  // Returns a reference to `name` in the trace's name table if the name is
+  // long enough to be interned, otherwise `name` itself. The result can be
+  // passed to Add*Event for many events, so the name is hashed once.
+  TraceEventName MaybeInternName(absl::string_view name) {
+    static constexpr size_t kNameInternThreshold = 32;
+    if (name.size() > kNameInternThreshold) return MaybeInternString(name);
+    return name;
+  }
+
   // Returns a device descriptor.
   Device* MutableDevice(uint32_t device_id) {
     return &(*trace_.mutable_devices())[device_id];
@@ -246,12 +374,13 @@ class TraceEventsContainerBase {
       const std::function<std::string(uint32_t /*device_id*/)>& device_name,
       const std::function<std::string(
           uint32_t /*device_id*/, uint32_t /*resource_id*/)>& resource_name) {
-    for (const auto& id_and_device : events_by_device_) {
+    for (auto& id_and_device : events_by_device_) {
       uint32_t device_id = id_and_device.first;
       auto& device = (*trace_.mutable_devices())[device_id];
       device.set_device_id(device_id);
       device.set_name(device_name(device_id));
-      const DeviceEvents& device_events = id_and_device.second;
+      DeviceEvents& device_events = id_and_device.second;
+      device_events.events_by_resource.SortByResourceId();
       for (const auto& id_and_resource : device_events.events_by_resource) {
         uint32_t resource_id = id_and_resource.first;
         auto& resource = (*device.mutable_resources())[resource_id];
@@ -268,12 +397,17 @@ class TraceEventsContainerBase {
   }
 
   // Stores the contents of this container in a level-db sstable file.
+  // If `colorer` is given, event colors are assigned once here and stored with
+  // the events, so JSON generation from the table does not need a colorer.
   absl::Status StoreAsLevelDbTable(
-      std::unique_ptr<tsl::WritableFile> file) const {
+      std::unique_ptr<tsl::WritableFile> file,
+      TraceEventsColorerInterface* colorer = nullptr,
+      const TraceTableOptions& table_options = TraceTableOptions()) const {
     Trace trace = trace_;
     trace.set_num_events(NumEvents());
     auto events_by_level = EventsByLevel();
-    return DoStoreAsLevelDbTable(file, trace, events_by_level);
+    return DoStoreAsLevelDbTable(file, trace, events_by_level, colorer,
+                                 table_options);
   }
 
   std::vector<std::vector<const TraceEvent*>> GetTraceEventsByLevel() const {
@@ -288,11 +422,23 @@ class TraceEventsContainerBase {
       std::unique_ptr<TraceEventsFilterInterface> filter = nullptr,
       std::unique_ptr<TraceVisibilityFilter> visibility = nullptr,
       int64_t filter_by_visibility_threshold = -1LL) {
-    return DoLoadFromLevelDbTable(
+    absl::Status status = DoLoadFromLevelDbTable(
         filename, std::move(filter), std::move(visibility),
         filter_by_visibility_threshold, trace_, filter_by_visibility_,
         absl::bind_front(&TraceEventsContainerBase::CopyEventToArena, this),
         absl::bind_front(&TraceEventsContainerBase::AddArenaEvent, this));
+    SortTracks();
+    return status;
+  }
+
+  // Orders the resource tracks of each device by resource_id. Called once all
+  // events have been added; until then, tracks are visited in the order their
+  // resources were first seen. The const accessors never reorder tracks, so a
+  // built container can be read concurrently.
+  void SortTracks() {
+    for (auto& [device_id, device] : events_by_device_) {
+      device.events_by_resource.SortByResourceId();
+    }
   }
 
   // Calls 'callback' with all events stored in this container.
@@ -331,6 +477,21 @@ class TraceEventsContainerBase {
     }
   }
 
+  // Calls 'callback' with the resource event tracks that have events
+  // overlapping `span`. Resources that are empty or inactive during `span` are
+  // skipped without visiting their events. Counter tracks are not included.
+  template <typename Callback>
+  void ForAllTracksInSpan(const tsl::profiler::Timespan& span,
+                          Callback callback) const {
+    for (const auto& [device_id, device] : events_by_device_) {
+      device.events_by_resource.ForEachActiveTrack(
+          span, [&callback, device_id = device_id](
+                    uint32_t resource_id, const TraceEventTrack& events) {
+            callback(device_id, resource_id, events);
+          });
+    }
+  }
+
   // Calls 'callback' with all event tracks stored in this container.
   template <typename Callback>
   void ForAllMutableTracks(Callback callback) const {
@@ -349,22 +510,23 @@ class TraceEventsContainerBase {
   }
 
   // Calls 'callback' with all event flows stored in this container.
+  // Flows are assembled from the flow index built as events are added, and
+  // each flow is passed in a reused buffer.
   template <typename Callback>
   void ForAllFlows(Callback callback) const {
-    absl::flat_hash_map<uint64_t /*flow_id*/, TraceEventFlow> flows;
-    for (const auto& [device_id, device] : events_by_device_) {
-      // Counter events are not flow events.
-      for (const auto& [resource_id, events] : device.events_by_resource) {
-        for (auto* event : events) {
-          if (event->has_flow_id()) flows[event->flow_id()].push_back(event);
-        }
+    TraceEventFlow combined_flow;
+    TraceEventFlow flow;
+    for (const FlowSlot& slot : flow_slots_) {
+      combined_flow.clear();
+      for (uint32_t link = slot.head; link != kNoFlowLink;
+           link = flow_links_[link].next) {
+        combined_flow.push_back(flow_links_[link].event);
       }
-    }
-    for (auto& [flow_id, combined_flow] : flows) {
       // If the flow_id is reused, split into individual flows.
-      for (auto& flow : SplitEventFlow(std::move(combined_flow))) {
-        callback(flow_id, flow);
-      }
+      ForEachSplitEventFlow(combined_flow, flow,
+                            [&callback, &slot](TraceEventFlow& split_flow) {
+                              callback(slot.flow_id, split_flow);
+                            });
     }
   }
 
@@ -389,7 +551,8 @@ class TraceEventsContainerBase {
   size_t NumTracks() const {
     return std::accumulate(
         events_by_device_.begin(), events_by_device_.end(), 0,
-        [](const size_t tracks, const std::pair<uint32_t, DeviceEvents> item) {
+        [](const size_t tracks,
+           const std::pair<const uint32_t, DeviceEvents>& item) {
           return tracks + item.second.counter_events_by_name.size() +
                  item.second.events_by_resource.size();
         });
@@ -415,7 +578,25 @@ class TraceEventsContainerBase {
     if (!event->has_resource_id()) {
       device_events.counter_events_by_name[event->name()].push_back(event);
     } else {
-      device_events.events_by_resource[event->resource_id()].push_back(event);
+      device_events.events_by_resource.Add(event);
+      // Counter and async events are not flow events.
+      if (event->has_flow_id()) AddFlowLink(event);
+    }
+  }
+
+  // Appends an event to the flow index, creating the slot for its flow_id on
+  // first use.
+  void AddFlowLink(TraceEvent* event) {
+    uint32_t link = flow_links_.size();
+    flow_links_.push_back({event, kNoFlowLink});
+    auto [it, inserted] =
+        flow_slot_by_id_.try_emplace(event->flow_id(), flow_slots_.size());
+    if (inserted) {
+      flow_slots_.push_back({event->flow_id(), link, link});
+    } else {
+      FlowSlot& slot = flow_slots_[it->second];
+      flow_links_[slot.tail].next = link;
+      slot.tail = link;
     }
   }
 
@@ -431,12 +612,16 @@ class TraceEventsContainerBase {
   std::vector<TraceEvent*> SortedEvents() const {
     std::vector<const TraceEventTrack*> event_tracks;
     event_tracks.reserve(NumTracks());
-    ForAllMutableTracks(
-        [&event_tracks](uint32_t device_id,
-                        std::variant<uint32_t, absl::string_view> resource_id,
-                        TraceEventTrack* events) {
-          event_tracks.push_back(events);
-        });
+    for (const auto& [device_id, device] : events_by_device_) {
+      for (const auto& [counter_name, events] : device.counter_events_by_name) {
+        if (!events.empty()) event_tracks.push_back(&events);
+      }
+      // Every event is merged, so all resource tracks are visited rather than
+      // only those active within the trace span.
+      for (const auto& [resource_id, events] : device.events_by_resource) {
+        if (!events.empty()) event_tracks.push_back(&events);
+      }
+    }
     return MergeEventTracks(event_tracks);
   }
 
@@ -449,19 +634,22 @@ class TraceEventsContainerBase {
     return fp;
   }
 
-  void MaybeInternEventName(TraceEvent* event, absl::string_view name) {
-    static constexpr size_t kNameInternThreshold = 32;
-    if (name.size() > kNameInternThreshold) {
-      event->set_name_ref(MaybeInternString(name));
+  void MaybeInternEventName(TraceEvent* event, const TraceEventName& name) {
+    if (const auto* name_view = std::get_if<absl::string_view>(&name)) {
+      TraceEventName maybe_interned = MaybeInternName(*name_view);
+      if (const auto* name_ref = std::get_if<uint64_t>(&maybe_interned)) {
+        event->set_name_ref(*name_ref);
+      } else {
+        event->set_name(name_view->data(), name_view->size());
+      }
     } else {
-      event->set_name(name.data(), name.size());
+      event->set_name_ref(std::get<uint64_t>(name));
     }
   }
 
   void MaybeInternTraceArgument(RawData* raw_data) {
     if (raw_data->has_args()) {
       for (auto& arg : *raw_data->mutable_args()->mutable_arg()) {
-        constexpr size_t kTraceArgInternThreshold = 16;
         if (arg.has_str_value() &&
             arg.str_value().size() > kTraceArgInternThreshold) {
           // Use name table to string intern the trace argument.
@@ -476,6 +664,37 @@ class TraceEventsContainerBase {
     }
   }
 
+  // Sets the serialized raw_data of the event. Argument sets are often
+  // identical across repeated instances of an op, so a set seen more than once
+  // is stored in the trace's raw_data_table and referenced from the event.
+  void MaybeInternRawData(TraceEvent* event, RawData* raw_data) {
+    MaybeInternTraceArgument(raw_data);
+    raw_data->SerializePartialToString(&raw_data_buffer_);
+    if (raw_data_buffer_.empty()) return;
+    static constexpr size_t kRawDataInternThreshold = 32;
+    if (raw_data_buffer_.size() > kRawDataInternThreshold) {
+      uint64_t fp = hash_(raw_data_buffer_);
+      auto& raw_data_table = *trace_.mutable_raw_data_table();
+      if (auto it = raw_data_table.find(fp); it != raw_data_table.end()) {
+        // A different set with the same fingerprint stays inline.
+        if (it->second == raw_data_buffer_) {
+          event->set_raw_data_ref(fp);
+          return;
+        }
+      } else if (!seen_raw_data_.insert(fp).second &&
+                 raw_data_table_bytes_ + raw_data_buffer_.size() <=
+                     kRawDataTableMaxBytes) {
+        // Unique argument sets stay inline so they don't grow the trace
+        // metadata.
+        raw_data_table_bytes_ += raw_data_buffer_.size();
+        raw_data_table[fp] = raw_data_buffer_;
+        event->set_raw_data_ref(fp);
+        return;
+      }
+    }
+    event->set_raw_data(raw_data_buffer_);
+  }
+
   // Events shown within a single device.
   struct DeviceEvents {
     // Counter events, which are per-device (don't have resource_id), and are
@@ -483,12 +702,28 @@ class TraceEventsContainerBase {
     absl::flat_hash_map<std::string, TraceEventTrack> counter_events_by_name;
 
     // Complete events and flow events, mapped by resource_id.
-    std::map<uint32_t, TraceEventTrack> events_by_resource;
+    ResourceEventsStore events_by_resource;
   };
 
   // Events, mapped by device_id.
   mutable std::map<uint32_t, DeviceEvents> events_by_device_;
 
+  // Index of flow events, built as events are added. The events of each flow
+  // are chained through flow_links_, so no per-flow container is allocated.
+  static constexpr uint32_t kNoFlowLink = ~0u;
+  struct FlowLink {
+    TraceEvent* event;
+    uint32_t next;  // Index of the next link in the same flow.
+  };
+  struct FlowSlot {
+    uint64_t flow_id;
+    uint32_t head;  // Index of the first link of this flow.
+    uint32_t tail;  // Index of the last link of this flow.
+  };
+  absl::flat_hash_map<uint64_t /*flow_id*/, uint32_t> flow_slot_by_id_;
+  std::vector<FlowSlot> flow_slots_;
+  std::vector<FlowLink> flow_links_;
+
   // Indicator on if visibility filtering is applied or not
   // Currently skip visibility filtering only applies to ssTable
   bool filter_by_visibility_ = true;
@@ -500,6 +735,13 @@ class TraceEventsContainerBase {
 
   Trace trace_;
   Hash hash_;
+
+  // Fingerprints of the serialized RawData seen so far, and a scratch buffer
+  // to serialize into. Used by MaybeInternRawData.
+  absl::flat_hash_set<uint64_t> seen_raw_data_;
+  std::string raw_data_buffer_;
+  // Total size of the values in trace_.raw_data_table.
+  size_t raw_data_table_bytes_ = 0;
 };
 
 }  // namespace profiler
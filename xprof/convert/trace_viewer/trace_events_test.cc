@@ -0,0 +1,481 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "xprof/convert/trace_viewer/trace_events.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/internal/endian.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "<gtest/gtest.h>"
+#include "xla/tsl/lib/io/iterator.h"
+#include "xla/tsl/lib/io/table.h"
+#include "xla/tsl/lib/io/table_options.h"
+#include "xla/tsl/platform/env.h"
+#include "xla/tsl/profiler/utils/timespan.h"
+#include "xprof/convert/trace_viewer/trace_events_to_json.h"
+#include "xprof/convert/trace_viewer/trace_viewer_color.h"
+#include "plugin/xprof/protobuf/trace_events.pb.h"
+#include "plugin/xprof/protobuf/trace_events_raw.pb.h"
+
+namespace tensorflow {
+namespace profiler {
+namespace {
+
+// Creates `num_tracks` sorted tracks with `events_per_track` events each. Many
+// events share timestamps across tracks to exercise ties at slice boundaries.
+std::vector<TraceEventTrack> CreateTracks(EventFactory& factory,
+                                          size_t num_tracks,
+                                          size_t events_per_track) {
+  std::vector<TraceEventTrack> tracks(num_tracks);
+  uint64_t seed = 1;
+  for (size_t t = 0; t < num_tracks; ++t) {
+    uint64_t timestamp_ps = 0;
+    for (size_t i = 0; i < events_per_track; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      timestamp_ps += (seed >> 60);
+      TraceEvent* event = factory.Create();
+      event->set_resource_id(t);
+      event->set_timestamp_ps(timestamp_ps);
+      event->set_duration_ps(1 + ((seed >> 40) & 0xf));
+      tracks[t].push_back(event);
+    }
+    absl::c_sort(tracks[t], TraceEventsComparator());
+  }
+  return tracks;
+}
+
+std::vector<const TraceEventTrack*> TrackPointers(
+    const std::vector<TraceEventTrack>& tracks) {
+  std::vector<const TraceEventTrack*> pointers;
+  for (const auto& track : tracks) pointers.push_back(&track);
+  return pointers;
+}
+
+TEST(MergeEventTracksTest, EmptyInput) {
+  EXPECT_TRUE(MergeEventTracks({}).empty());
+}
+
+TEST(MergeEventTracksTest, SmallInputIsSorted) {
+  EventFactory factory;
+  std::vector<TraceEventTrack> tracks = CreateTracks(factory, 4, 100);
+  std::vector<TraceEvent*> events = MergeEventTracks(TrackPointers(tracks));
+  EXPECT_EQ(events.size(), 400);
+  EXPECT_TRUE(absl::c_is_sorted(events, TraceEventsComparator()));
+}
+
+// Returns the events of all tracks stably sorted, which orders events that
+// compare equal by track index.
+std::vector<TraceEvent*> StableSortedEvents(
+    const std::vector<TraceEventTrack>& tracks) {
+  std::vector<TraceEvent*> events;
+  for (const auto& track : tracks) {
+    events.insert(events.end(), track.begin(), track.end());
+  }
+  absl::c_stable_sort(events, TraceEventsComparator());
+  return events;
+}
+
+TEST(MergeEventTracksTest, SmallInputBreaksTiesByTrack) {
+  EventFactory factory;
+  std::vector<TraceEventTrack> tracks = CreateTracks(factory, 4, 100);
+  EXPECT_EQ(MergeEventTracks(TrackPointers(tracks)),
+            StableSortedEvents(tracks));
+}
+
+TEST(MergeEventTracksTest, LargeInputBreaksTiesByTrack) {
+  EventFactory factory;
+  std::vector<TraceEventTrack> tracks = CreateTracks(factory, 64, 8192);
+  EXPECT_EQ(MergeEventTracks(TrackPointers(tracks)),
+            StableSortedEvents(tracks));
+}
+
+using TestContainer = TraceEventsContainerBase<EventFactory, RawData>;
+using ::tsl::profiler::Timespan;
+
+TEST(TraceEventsContainerTest, ForAllFlowsSplitsReusedFlowIds) {
+  TestContainer container;
+  // Flow 1 is used twice, flow 2 once, and the events are added out of order.
+  container.AddFlowEvent("a", 1, 1, Timespan(100, 10), 1,
+                         TraceEvent::FLOW_START);
+  container.AddFlowEvent("b", 2, 1, Timespan(20, 10), 1, TraceEvent::FLOW_END);
+  container.AddFlowEvent("c", 1, 1, Timespan(0, 10), 1,
+                         TraceEvent::FLOW_START);
+  container.AddFlowEvent("d", 2, 1, Timespan(50, 10), 2,
+                         TraceEvent::FLOW_START);
+  container.AddFlowEvent("e", 2, 1, Timespan(120, 10), 1,
+                         TraceEvent::FLOW_END);
+  container.AddCompleteEvent("f", 1, 1, Timespan(5, 10));
+
+  std::vector<std::pair<uint64_t, std::vector<std::string>>> flows;
+  container.ForAllFlows([&flows](uint64_t flow_id, const TraceEventFlow& flow) {
+    std::vector<std::string> names;
+    for (const TraceEvent* event : flow) names.push_back(event->name());
+    flows.emplace_back(flow_id, std::move(names));
+  });
+
+  using Flow = std::pair<uint64_t, std::vector<std::string>>;
+  EXPECT_EQ(flows.size(), 3);
+  EXPECT_EQ(flows[0], Flow(1, {"c", "b"}));
+  EXPECT_EQ(flows[1], Flow(1, {"a", "e"}));
+  EXPECT_EQ(flows[2], Flow(2, {"d"}));
+}
+
+TEST(TraceEventsContainerTest, RepeatedRawDataIsInterned) {
+  TestContainer container;
+  RawData raw_data;
+  auto add_event = [&](uint64_t timestamp_ps, int64_t program_id) {
+    raw_data.Clear();
+    TraceEventArguments* args = raw_data.mutable_args();
+    auto* arg = args->add_arg();
+    arg->set_name("program_id");
+    arg->set_int_value(program_id);
+    arg = args->add_arg();
+    arg->set_name("bytes_accessed");
+    arg->set_uint_value(1 << 30);
+    container.AddCompleteEvent("op", 1, 1, Timespan(timestamp_ps, 10),
+                               &raw_data);
+  };
+  add_event(0, 1);
+  add_event(20, 1);
+  add_event(40, 1);
+  add_event(60, 2);
+
+  EXPECT_EQ(container.trace().raw_data_table_size(), 1);
+  std::vector<int64_t> program_ids;
+  int num_refs = 0;
+  container.ForAllEvents([&](const TraceEvent& event) {
+    num_refs += event.has_raw_data_ref();
+    RawData parsed;
+    absl::string_view serialized = EventRawData(container.trace(), event);
+    ASSERT_TRUE(parsed.ParseFromArray(serialized.data(), serialized.size()));
+    program_ids.push_back(parsed.args().arg(0).int_value());
+  });
+  // The first occurrence of each argument set is stored inline.
+  EXPECT_EQ(num_refs, 2);
+  EXPECT_EQ(program_ids, std::vector<int64_t>({1, 1, 1, 2}));
+}
+
+// Adds an "op" event at `timestamp_ps` whose arguments hold `program_id`.
+template <typename Container>
+void AddEventWithProgramId(Container& container, uint64_t timestamp_ps,
+                           int64_t program_id) {
+  RawData raw_data;
+  TraceEventArguments* args = raw_data.mutable_args();
+  auto* arg = args->add_arg();
+  arg->set_name("program_id");
+  arg->set_int_value(program_id);
+  arg = args->add_arg();
+  arg->set_name("bytes_accessed");
+  arg->set_uint_value(1 << 30);
+  container.AddCompleteEvent("op", 1, 1, Timespan(timestamp_ps, 10),
+                             &raw_data);
+}
+
+// Returns the program_id argument of each event of `container`.
+template <typename Container>
+std::vector<int64_t> ProgramIds(const Container& container) {
+  std::vector<int64_t> program_ids;
+  container.ForAllEvents([&](const TraceEvent& event) {
+    RawData parsed;
+    absl::string_view serialized = EventRawData(container.trace(), event);
+    EXPECT_TRUE(parsed.ParseFromArray(serialized.data(), serialized.size()));
+    program_ids.push_back(parsed.args().arg(0).int_value());
+  });
+  return program_ids;
+}
+
+// Maps every string to the same fingerprint.
+struct CollidingHash {
+  uint64_t operator()(absl::string_view) const { return 42; }
+};
+
+TEST(TraceEventsContainerTest, RawDataWithCollidingFingerprintStaysInline) {
+  TraceEventsContainerBase<EventFactory, RawData, CollidingHash> container;
+  AddEventWithProgramId(container, 0, 1);
+  AddEventWithProgramId(container, 20, 1);
+  AddEventWithProgramId(container, 40, 2);
+  AddEventWithProgramId(container, 60, 2);
+
+  EXPECT_EQ(container.trace().raw_data_table_size(), 1);
+  EXPECT_EQ(ProgramIds(container), std::vector<int64_t>({1, 1, 2, 2}));
+}
+
+TEST(TraceEventsContainerTest, RawDataTableSizeIsBounded) {
+  TestContainer container;
+  constexpr int kNumSets = 50000;
+  for (int i = 0; i < kNumSets; ++i) {
+    AddEventWithProgramId(container, 4 * i * 10, i);
+    AddEventWithProgramId(container, (4 * i + 2) * 10, i);
+  }
+
+  size_t table_bytes = 0;
+  for (const auto& [fp, raw_data] : container.trace().raw_data_table()) {
+    table_bytes += raw_data.size();
+  }
+  EXPECT_GT(container.trace().raw_data_table_size(), 0);
+  EXPECT_LT(container.trace().raw_data_table_size(), kNumSets);
+  EXPECT_LE(table_bytes, TestContainer::kRawDataTableMaxBytes);
+  std::vector<int64_t> program_ids = ProgramIds(container);
+  ASSERT_EQ(program_ids.size(), 2 * kNumSets);
+  for (int i = 0; i < kNumSets; ++i) {
+    EXPECT_EQ(program_ids[2 * i], i);
+    EXPECT_EQ(program_ids[2 * i + 1], i);
+  }
+}
+
+TEST(TraceEventsContainerTest, TracksAreVisitedInResourceIdOrder) {
+  TestContainer container;
+  container.AddCompleteEvent("a", 30, 1, Timespan(0, 10));
+  container.AddCompleteEvent("b", 10, 1, Timespan(5, 10));
+  container.AddCompleteEvent("c", 20, 1, Timespan(100, 10));
+  container.AddCompleteEvent("d", 10, 1, Timespan(200, 10));
+  container.SortTracks();
+
+  std::vector<std::string> names;
+  container.ForAllEvents(
+      [&names](const TraceEvent& event) { names.push_back(event.name()); });
+  EXPECT_EQ(names, std::vector<std::string>({"b", "d", "c", "a"}));
+  EXPECT_EQ(container.NumTracks(), 3);
+}
+
+TEST(TraceEventsContainerTest, EventsOutsideTheTraceSpanAreStored) {
+  TestContainer container;
+  container.AddCompleteEvent("a", 1, 1, Timespan(0, 10));
+  // Timestamps this large do not widen the trace span.
+  container.AddCompleteEvent(
+      "b", 2, 1, Timespan(std::numeric_limits<uint64_t>::max() / 2 + 10, 10));
+  container.SortTracks();
+
+  size_t num_events = 0;
+  for (const auto& level : container.GetTraceEventsByLevel()) {
+    num_events += level.size();
+  }
+  EXPECT_EQ(num_events, 2);
+}
+
+TEST(TraceEventsContainerTest, ForAllTracksInSpanSkipsInactiveResources) {
+  TestContainer container;
+  container.AddCompleteEvent("a", 1, 1, Timespan(0, 10));
+  container.AddCompleteEvent("b", 1, 1, Timespan(20, 10));
+  container.AddCompleteEvent("c", 2, 1, Timespan(100, 10));
+  container.AddCompleteEvent("d", 3, 2, Timespan(25, 50));
+
+  std::vector<std::pair<uint32_t, uint32_t>> tracks;
+  container.ForAllTracksInSpan(
+      Timespan::FromEndPoints(22, 40),
+      [&tracks](uint32_t device_id, uint32_t resource_id,
+                const TraceEventTrack& events) {
+        tracks.emplace_back(device_id, resource_id);
+      });
+  EXPECT_EQ(tracks, (std::vector<std::pair<uint32_t, uint32_t>>(
+                        {{1, 1}, {2, 3}})));
+}
+
+// Stores a container with `num_events` events as a LevelDB table at `path`.
+void StoreTable(const std::string& path, int num_events,
+                const TraceTableOptions& table_options = TraceTableOptions()) {
+  TestContainer container;
+  for (int i = 0; i < num_events; ++i) {
+    container.AddCompleteEvent("op", 1, 1, Timespan(i * 100, 10 + i));
+  }
+  std::unique_ptr<tsl::WritableFile> file;
+  ASSERT_TRUE(tsl::Env::Default()->NewWritableFile(path, &file).ok());
+  ASSERT_TRUE(
+      container.StoreAsLevelDbTable(std::move(file), nullptr, table_options)
+          .ok());
+}
+
+TEST(TraceEventsContainerTest, RewrittenLevelDbTableIsReopened) {
+  std::string path =
+      absl::StrCat(::testing::TempDir(), "/rewritten_trace.ldb");
+  StoreTable(path, 3);
+  Trace trace;
+  ASSERT_TRUE(ReadFileTraceMetadata(path, &trace).ok());
+  EXPECT_EQ(trace.num_events(), 3);
+
+  // Loading the same table again reuses the open table.
+  TestContainer loaded;
+  ASSERT_TRUE(loaded.LoadFromLevelDbTable(path).ok());
+  EXPECT_EQ(loaded.NumEvents(), 3);
+
+  StoreTable(path, 5);
+  ASSERT_TRUE(ReadFileTraceMetadata(path, &trace).ok());
+  EXPECT_EQ(trace.num_events(), 5);
+  TestContainer reloaded;
+  ASSERT_TRUE(reloaded.LoadFromLevelDbTable(path).ok());
+  EXPECT_EQ(reloaded.NumEvents(), 5);
+}
+
+TEST(TraceEventsContainerTest, LevelDbTableWithSmallTiledBlocksRoundTrips) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/tiled_trace.ldb");
+  TraceTableOptions table_options;
+  table_options.levels = {{/*block_size=*/1 << 20, /*tile_ps=*/0},
+                          {/*block_size=*/64, /*tile_ps=*/1000}};
+  table_options.compression = tsl::table::kNoCompression;
+  StoreTable(path, 100, table_options);
+
+  TestContainer loaded;
+  ASSERT_TRUE(loaded.LoadFromLevelDbTable(path).ok());
+  std::vector<uint64_t> timestamps;
+  loaded.ForAllEvents([&timestamps](const TraceEvent& event) {
+    timestamps.push_back(event.timestamp_ps());
+  });
+  ASSERT_EQ(timestamps.size(), 100);
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(timestamps[i], i * 100);
+}
+
+// An event stored in a LevelDB table, located by the offset of its data block.
+struct StoredEvent {
+  uint64_t block_offset;
+  uint64_t timestamp_ps;
+  size_t bytes;
+};
+
+// Reads the events of the LevelDB table at `path`, grouped by zoom level.
+void ReadStoredEvents(const std::string& path,
+                      std::map<char, std::vector<StoredEvent>>* events) {
+  uint64_t file_size = 0;
+  ASSERT_TRUE(tsl::Env::Default()->GetFileSize(path, &file_size).ok());
+  std::unique_ptr<tsl::RandomAccessFile> file;
+  ASSERT_TRUE(tsl::Env::Default()->NewRandomAccessFile(path, &file).ok());
+  tsl::table::Table* table = nullptr;
+  ASSERT_TRUE(tsl::table::Table::Open(tsl::table::Options(), file.get(),
+                                      file_size, &table)
+                  .ok());
+  std::unique_ptr<tsl::table::Table> table_owner(table);
+  std::unique_ptr<tsl::table::Iterator> iterator(table->NewIterator());
+  for (iterator->SeekToFirst(); iterator->Valid(); iterator->Next()) {
+    absl::string_view key = iterator->key();
+    if (key == "/trace") continue;
+    // Keys are the zoom level, the big-endian timestamp and a tie breaker.
+    ASSERT_EQ(key.size(), 10);
+    (*events)[key[0]].push_back(
+        {table->ApproximateOffsetOf(key),
+         absl::big_endian::Load64(key.data() + 1),
+         key.size() + iterator->value().size()});
+  }
+}
+
+TEST(TraceEventsContainerTest, LevelDbTableBlocksFollowTheLevelLayout) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/layout_trace.ldb");
+  constexpr size_t kBlockSize = 64;
+  constexpr uint64_t kTilePs = 1000;
+  TraceTableOptions table_options;
+  table_options.levels = {{/*block_size=*/1 << 20, /*tile_ps=*/0},
+                          {kBlockSize, kTilePs}};
+  table_options.compression = tsl::table::kNoCompression;
+  StoreTable(path, 100, table_options);
+
+  std::map<char, std::vector<StoredEvent>> events_by_level;
+  ReadStoredEvents(path, &events_by_level);
+  ASSERT_GE(events_by_level.size(), 2);
+
+  uint64_t previous_level_end = 0;
+  size_t num_tiled_blocks = 0;
+  for (const auto& [level, events] : events_by_level) {
+    // Each level starts in a new block.
+    EXPECT_GT(events.front().block_offset, previous_level_end) << level;
+    previous_level_end = events.back().block_offset;
+    if (level == '1') {
+      // The coarsest level fits in one large block.
+      EXPECT_EQ(events.front().block_offset, events.back().block_offset);
+      continue;
+    }
+    // Finer levels are cut at the block size and at tile boundaries.
+    size_t block_bytes = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+      if (i == 0 || events[i].block_offset != events[i - 1].block_offset) {
+        ++num_tiled_blocks;
+        block_bytes = 0;
+      } else {
+        EXPECT_LT(block_bytes, kBlockSize) << level << " " << i;
+        EXPECT_EQ(events[i].timestamp_ps / kTilePs,
+                  events[i - 1].timestamp_ps / kTilePs)
+            << level << " " << i;
+      }
+      block_bytes += events[i].bytes;
+    }
+  }
+  EXPECT_GE(num_tiled_blocks, 10);
+}
+
+// Colors events by the length of their name plus an offset, and counts how
+// often it is set up.
+class NameLengthColorer : public TraceEventsColorerInterface {
+ public:
+  explicit NameLengthColorer(uint32_t offset) : offset_(offset) {}
+
+  void SetUp(const Trace& trace) override { ++num_set_ups_; }
+
+  std::optional<uint32_t> GetColor(const TraceEvent& event) const override {
+    return event.name().size() + offset_;
+  }
+
+  int num_set_ups() const { return num_set_ups_; }
+
+ private:
+  uint32_t offset_;
+  int num_set_ups_ = 0;
+};
+
+TEST(TraceEventsContainerTest, JsonUsesColorsStoredInLevelDbTable) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/colored_trace.ldb");
+  TestContainer container;
+  container.AddCompleteEvent("a", 1, 1, Timespan(0, 10));
+  container.AddCompleteEvent("abc", 1, 1, Timespan(100, 10));
+  NameLengthColorer store_colorer(/*offset=*/0);
+  std::unique_ptr<tsl::WritableFile> file;
+  ASSERT_TRUE(tsl::Env::Default()->NewWritableFile(path, &file).ok());
+  ASSERT_TRUE(container.StoreAsLevelDbTable(std::move(file), &store_colorer)
+                  .ok());
+  EXPECT_EQ(store_colorer.num_set_ups(), 1);
+
+  TestContainer loaded;
+  ASSERT_TRUE(loaded.LoadFromLevelDbTable(path).ok());
+  EXPECT_TRUE(loaded.trace().colors_precomputed());
+  NameLengthColorer serve_colorer(/*offset=*/10);
+  JsonTraceOptions options;
+  options.colorer = &serve_colorer;
+  std::string json;
+  IOBufferAdapter adapter(&json);
+  TraceEventsToJson<IOBufferAdapter, TestContainer, RawData>(options, loaded,
+                                                             &adapter);
+
+  // The serving colorer is neither set up nor asked for colors.
+  EXPECT_EQ(serve_colorer.num_set_ups(), 0);
+  auto has_color = [&json](uint32_t color_id) {
+    return absl::StrContains(
+        json, absl::StrCat(R"("cname":)", TraceViewerColorName(color_id)));
+  };
+  EXPECT_TRUE(has_color(1));
+  EXPECT_TRUE(has_color(3));
+  EXPECT_FALSE(has_color(11));
+  EXPECT_FALSE(has_color(13));
+}
+
+}  // namespace
+}  // namespace profiler
+}  // namespace tensorflow
@@ -180,7 +180,9 @@ class JsonEventWriter {
       uint64_t duration_ps = std::max(span.duration_ps(), uint64_t{1});
       absl::Format(output_, R"(,"dur":%.17g)", PicosToMicros(duration_ps));
 
-      if (std::optional<uint32_t> color_id = colorer_->GetColor(event)) {
+      if (event.has_color_id()) {
+        output_->Append(R"(,"cname":)", TraceViewerColorName(event.color_id()));
+      } else if (std::optional<uint32_t> color_id = colorer_->GetColor(event)) {
         output_->Append(R"(,"cname":)", TraceViewerColorName(*color_id));
       }
 
@@ -241,7 +243,7 @@ class JsonEventWriter {
             async_event->set_flow_entry_type(TraceEvent::FLOW_END);
             async_event->set_timestamp_ps(event.timestamp_ps() +
                                           event.duration_ps());
-            async_event->clear_raw_data();
+            async_event->clear_raw_data_oneof();
             break;
         }
       }
@@ -265,7 +267,8 @@ class JsonEventWriter {
 
  private:
   void WriteArgs(const TraceEvent& event) const {
-    if (!event.has_group_id() && !event.has_raw_data()) {
+    if (!event.has_group_id() &&
+        event.raw_data_oneof_case() == TraceEvent::RAW_DATA_ONEOF_NOT_SET) {
       return;
     }
     output_->Append(R"(,"args":{)");
@@ -275,9 +278,10 @@ class JsonEventWriter {
       separator.Add();
       output_->Append(R"("group_id":)", event.group_id());
     }
-    if (event.has_raw_data()) {
+    if (absl::string_view raw_data = EventRawData(trace_, event);
+        !raw_data.empty()) {
       RawDataType data;
-      data.ParseFromString(event.raw_data());
+      data.ParseFromArray(raw_data.data(), raw_data.size());
       switch (data.raw_data_case()) {
         case RawDataType::RAW_DATA_NOT_SET:
           break;
@@ -613,9 +617,13 @@ void TraceEventsToJson(const JsonTraceOptions& options,
     }
   }
 
+  // Colors assigned when the trace was stored are read from the events, so the
+  // colorer (and its set-up pass over the trace) is skipped.
   TraceEventsColorerInterface* colorer = options.colorer;
   DefaultTraceEventsColorer default_colorer;
-  if (colorer == nullptr) colorer = &default_colorer;
+  if (colorer == nullptr || trace.colors_precomputed()) {
+    colorer = &default_colorer;
+  }
   colorer->SetUp(trace);
 
   // Write events.
@@ -20,7 +20,6 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
-#include "absl/algorithm/container.h"
 #include "absl/strings/string_view.h"
 #include "xla/tsl/profiler/utils/timespan.h"
 #include "plugin/xprof/protobuf/trace_events.pb.h"
@@ -28,29 +27,12 @@ limitations under the License.
 namespace tensorflow {
 namespace profiler {
 
-// Functor that compares flow events for sorting.
-struct FlowEventsComparator {
-  bool operator()(const TraceEvent* a, const TraceEvent* b) const {
-    if (a->timestamp_ps() < b->timestamp_ps()) return true;
-    if (a->timestamp_ps() > b->timestamp_ps()) return false;
-    return (a->flow_entry_type() < b->flow_entry_type());
-  }
-};
-
 std::vector<TraceEventFlow> SplitEventFlow(TraceEventFlow&& flow) {
   std::vector<TraceEventFlow> flows;
-  absl::c_sort(flow, FlowEventsComparator());
-  TraceEventFlow* current = nullptr;
-  for (TraceEvent* event : flow) {
-    if (current == nullptr ||
-        event->flow_entry_type() == TraceEvent::FLOW_START) {
-      current = &flows.emplace_back();
-    }
-    current->push_back(event);
-    if (event->flow_entry_type() == TraceEvent::FLOW_END) {
-      current = nullptr;
-    }
-  }
+  TraceEventFlow current;
+  ForEachSplitEventFlow(flow, current, [&flows](TraceEventFlow& split_flow) {
+    flows.push_back(split_flow);
+  });
   return flows;
 }
 
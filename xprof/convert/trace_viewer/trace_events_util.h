@@ -22,6 +22,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/check.h"
 #include "absl/strings/string_view.h"
 #include "xla/tsl/profiler/utils/timespan.h"
@@ -42,6 +43,16 @@ inline absl::string_view ResourceName(const Trace& trace,
   return ResourceName(trace, event.device_id(), event.resource_id());
 }
 
+// Returns the serialized RawData of the given event in trace, which is either
+// stored inline or referenced from the trace's raw_data_table.
+inline absl::string_view EventRawData(const Trace& trace,
+                                      const TraceEvent& event) {
+  if (!event.has_raw_data_ref()) return event.raw_data();
+  auto it = trace.raw_data_table().find(event.raw_data_ref());
+  return it != trace.raw_data_table().end() ? absl::string_view(it->second)
+                                            : absl::string_view();
+}
+
 // Functor that compares trace events for sorting.
 // Trace events are sorted by timestamp_ps (ascending) and duration_ps
 // (descending) so nested events are sorted from outer to innermost.
@@ -68,10 +79,41 @@ inline tsl::profiler::Timespan TraceSpan(const Trace& trace) {
 // All events in the flow have the same flow_id.
 using TraceEventFlow = std::vector<TraceEvent*>;
 
+// Functor that compares flow events for sorting.
+struct FlowEventsComparator {
+  bool operator()(const TraceEvent* a, const TraceEvent* b) const {
+    if (a->timestamp_ps() < b->timestamp_ps()) return true;
+    if (a->timestamp_ps() > b->timestamp_ps()) return false;
+    return (a->flow_entry_type() < b->flow_entry_type());
+  }
+};
+
 // In case the flow_id was re-used, split into individual flows based on the
 // flow_entry_type.
 std::vector<TraceEventFlow> SplitEventFlow(TraceEventFlow&& flow);
 
+// Same as SplitEventFlow, but calls `callback` with each individual flow
+// instead of returning them. Sorts `combined_flow` in place and reuses `flow`
+// as the buffer passed to `callback`, so no per-flow vector is allocated.
+template <typename Callback>
+void ForEachSplitEventFlow(TraceEventFlow& combined_flow, TraceEventFlow& flow,
+                           Callback callback) {
+  absl::c_sort(combined_flow, FlowEventsComparator());
+  flow.clear();
+  for (TraceEvent* event : combined_flow) {
+    if (!flow.empty() && event->flow_entry_type() == TraceEvent::FLOW_START) {
+      callback(flow);
+      flow.clear();
+    }
+    flow.push_back(event);
+    if (event->flow_entry_type() == TraceEvent::FLOW_END) {
+      callback(flow);
+      flow.clear();
+    }
+  }
+  if (!flow.empty()) callback(flow);
+}
+
 // Returns whether the flow is complete.
 inline bool IsCompleteFlow(const TraceEventFlow& flow) {
   DCHECK(!flow.empty());
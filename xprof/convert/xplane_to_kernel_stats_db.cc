@@ -15,14 +15,18 @@ limitations under the License.
 
 #include "xprof/convert/xplane_to_kernel_stats_db.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <ostream>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_join.h"
@@ -41,6 +45,73 @@ limitations under the License.
 namespace tensorflow {
 namespace profiler {
 
+namespace {
+
+// The event properties a KernelReport is derived from. Launches of the same
+// kernel with the same key produce identical KernelReports, so they are
+// aggregated before any KernelReport is built.
+struct KernelLaunchKey {
+  int64_t metadata_id;
+  absl::string_view kernel_details;
+  absl::string_view tf_op_fullname;
+  absl::string_view equation;
+  absl::string_view hlo_op_name;
+  std::optional<uint64_t> program_id;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const KernelLaunchKey& key) {
+    return H::combine(std::move(h), key.metadata_id, key.kernel_details,
+                      key.tf_op_fullname, key.equation, key.hlo_op_name,
+                      key.program_id);
+  }
+
+  bool operator==(const KernelLaunchKey& other) const {
+    return metadata_id == other.metadata_id &&
+           program_id == other.program_id &&
+           kernel_details == other.kernel_details &&
+           tf_op_fullname == other.tf_op_fullname &&
+           equation == other.equation && hlo_op_name == other.hlo_op_name;
+  }
+};
+
+// A unique kernel launch configuration and its aggregated durations.
+struct KernelLaunches {
+  absl::string_view name;
+  GpuEventStats stats;
+  KernelReportValue value;
+};
+
+KernelReport CreateKernelReport(
+    absl::string_view name, const GpuEventStats& stats,
+    const std::function<void(const GpuEventStats&, KernelReport*)>&
+        on_kernel_fn) {
+  KernelReport kernel;
+  kernel.set_name(std::string(name));
+  kernel.set_is_kernel_using_tensor_core(IsKernelUsingTensorCore(name));
+  ParseKernelLaunchParams(stats.kernel_details, &kernel);
+
+  if (stats.IsTfOp()) {
+    tsl::profiler::TfOp tf_op =
+        tsl::profiler::ParseTfOpFullname(stats.tf_op_fullname);
+    kernel.set_op_name(std::string(tf_op.name));
+    bool tensor_core_eligible = IsEinsumTensorCoreEligible(stats.equation) ||
+                                IsOpTensorCoreEligible(kernel.op_name());
+    if (!tensor_core_eligible && kernel.is_kernel_using_tensor_core()) {
+      VLOG(1) << "Detected new Op using TensorCores: " << kernel.op_name()
+              << std::endl;
+      tensor_core_eligible = true;
+    }
+    kernel.set_is_op_tensor_core_eligible(tensor_core_eligible);
+  }
+
+  if (on_kernel_fn) {
+    on_kernel_fn(stats, &kernel);
+  }
+  return kernel;
+}
+
+}  // namespace
+
 void ConvertDeviceTraceXPlaneToKernelReports(
     const XPlane& device_trace,
     const std::function<void(const GpuEventStats&, KernelReport*)>&
@@ -48,51 +119,48 @@ void ConvertDeviceTraceXPlaneToKernelReports(
     KernelReportMap* reports) {
   tsl::profiler::XPlaneVisitor plane =
       tsl::profiler::CreateTfXPlaneVisitor(&device_trace);
+  GpuEventStatTypes stat_types(device_trace);
+  // Aggregated per unique launch configuration while the events are visited,
+  // so memory use does not grow with the number of kernel launches.
+  absl::flat_hash_map<KernelLaunchKey, KernelLaunches> launches;
   plane.ForEachLine([&](const tsl::profiler::XLineVisitor& line) {
     if (tsl::profiler::IsDerivedThreadId(line.Id())) {
       return;
     }
     line.ForEachEvent([&](const tsl::profiler::XEventVisitor& event) {
       if (event.DurationNs() == 0) return;
-      KernelReport kernel;
-      GpuEventStats stats(&event);
+      GpuEventStats stats(&event, stat_types);
       if (!stats.IsKernel()) return;
 
-      kernel.set_name(std::string(event.Name()));
-      kernel.set_is_kernel_using_tensor_core(
-          IsKernelUsingTensorCore(event.Name()));
-      kernel.set_total_duration_ns(event.DurationNs());
-      kernel.set_min_duration_ns(event.DurationNs());
-      kernel.set_max_duration_ns(event.DurationNs());
-      ParseKernelLaunchParams(stats.kernel_details, &kernel);
-
-      if (stats.IsTfOp()) {
-        tsl::profiler::TfOp tf_op =
-            tsl::profiler::ParseTfOpFullname(stats.tf_op_fullname);
-        kernel.set_op_name(std::string(tf_op.name));
-        bool tensor_core_eligible =
-            IsEinsumTensorCoreEligible(stats.equation) ||
-            IsOpTensorCoreEligible(kernel.op_name());
-        if (!tensor_core_eligible && kernel.is_kernel_using_tensor_core()) {
-          VLOG(1) << "Detected new Op using TensorCores: " << kernel.op_name()
-                  << std::endl;
-          tensor_core_eligible = true;
-        }
-        kernel.set_is_op_tensor_core_eligible(tensor_core_eligible);
-      }
-
-      if (on_kernel_fn) {
-        on_kernel_fn(stats, &kernel);
-      }
-
+      KernelLaunchKey key{
+          event.Id(),
+          stats.kernel_details,
+          stats.tf_op_fullname,
+          stats.equation,
+          stats.IsXlaOp() ? stats.hlo_op_names.back() : absl::string_view(),
+          stats.program_id};
       KernelReportValue value;
       value.total_duration_ns = event.DurationNs();
       value.min_duration_ns = event.DurationNs();
       value.max_duration_ns = event.DurationNs();
       value.occurrences = 1;
-      InsertOrUpdateKernelReport(kernel, value, reports);
+      auto [it, inserted] =
+          launches.try_emplace(key, KernelLaunches{event.Name(), stats, value});
+      if (inserted) return;
+      KernelReportValue& element = it->second.value;
+      element.total_duration_ns += value.total_duration_ns;
+      element.min_duration_ns =
+          std::min(element.min_duration_ns, value.min_duration_ns);
+      element.max_duration_ns =
+          std::max(element.max_duration_ns, value.max_duration_ns);
+      element.occurrences += value.occurrences;
     });
   });
+  for (const auto& [key, launch] : launches) {
+    InsertOrUpdateKernelReport(
+        CreateKernelReport(launch.name, launch.stats, on_kernel_fn),
+        launch.value, reports);
+  }
 }
 
 std::unique_ptr<DataTable> GenerateKernelStatsDataTable(
@@ -136,6 +136,64 @@ occ_pct:25.0)MULTI"},
   }
 }
 
+TEST(ConvertXplaneToKernelStats, RepeatedLaunchesAreAggregated) {
+  XSpace space;
+  XPlane* device_trace = space.add_planes();
+  tsl::profiler::XPlaneBuilder device_trace_builder(device_trace);
+  tsl::profiler::XLineBuilder line_builder =
+      device_trace_builder.GetOrCreateLine(0);
+  constexpr absl::string_view kKernelDetails = R"MULTI(regs:16
+static_shared:0
+dynamic_shared:0
+grid:1,1,1
+block:1,1,1
+occ_pct:50.0)MULTI";
+  CreateXEvent(&device_trace_builder, &line_builder, "kernel",
+               /*offset_ps=*/10000, /*duration_ps=*/1000,
+               {{StatType::kTfOp, "mul_786"},
+                {StatType::kKernelDetails, kKernelDetails}});
+  CreateXEvent(&device_trace_builder, &line_builder, "kernel",
+               /*offset_ps=*/20000, /*duration_ps=*/3000,
+               {{StatType::kTfOp, "mul_786"},
+                {StatType::kKernelDetails, kKernelDetails}});
+  CreateXEvent(&device_trace_builder, &line_builder, "kernel",
+               /*offset_ps=*/30000, /*duration_ps=*/2000,
+               {{StatType::kTfOp, "mul_787"},
+                {StatType::kKernelDetails, kKernelDetails}});
+  // A different TF op whose name parses to the same op name.
+  CreateXEvent(&device_trace_builder, &line_builder, "kernel",
+               /*offset_ps=*/40000, /*duration_ps=*/4000,
+               {{StatType::kTfOp, "mul_786:Mul"},
+                {StatType::kKernelDetails, kKernelDetails}});
+
+  KernelReportMap reports;
+  int num_kernel_fn_calls = 0;
+  ConvertDeviceTraceXPlaneToKernelReports(
+      *device_trace,
+      [&num_kernel_fn_calls](const GpuEventStats& stats,
+                             KernelReport* kernel) { ++num_kernel_fn_calls; },
+      &reports);
+  KernelStatsDb kernel_stats;
+  CopyTopKDurationKernelReportsToDb(reports, &kernel_stats);
+
+  EXPECT_EQ(num_kernel_fn_calls, 3);
+  ASSERT_EQ(kernel_stats.reports_size(), 2);
+  {
+    const auto& kernel = kernel_stats.reports().at(0);
+    EXPECT_EQ(kernel.op_name(), "mul_786");
+    EXPECT_EQ(kernel.occurrences(), 3);
+    EXPECT_EQ(kernel.total_duration_ns(), 8);
+    EXPECT_EQ(kernel.min_duration_ns(), 1);
+    EXPECT_EQ(kernel.max_duration_ns(), 4);
+  }
+  {
+    const auto& kernel = kernel_stats.reports().at(1);
+    EXPECT_EQ(kernel.op_name(), "mul_787");
+    EXPECT_EQ(kernel.occurrences(), 1);
+    EXPECT_EQ(kernel.total_duration_ns(), 2);
+  }
+}
+
 }  // namespace
 }  // namespace profiler
 }  // namespace tensorflow
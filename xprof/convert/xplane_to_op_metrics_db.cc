@@ -18,7 +18,6 @@ limitations under the License.
 #include <algorithm>
 #include <cstdint>
 #include <limits>
-#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -53,11 +52,13 @@ namespace profiler {
 namespace {
 
 using ::tensorflow::profiler::GpuEventStats;
+using ::tensorflow::profiler::GpuEventStatTypes;
 using ::tsl::uint32;
 using ::tsl::uint64;
 using ::tsl::profiler::GetDeviceEventTimespan;
 
 struct HLOTracker {
+  uint64_t begin_ps = 0;
   uint64_t duration = 0;
   uint64_t program_id = 0;
   uint64_t group_id = 0;
@@ -66,12 +67,33 @@ struct HLOTracker {
   std::string hlo_op_name;
 
   void Reset() {
-    duration = program_id = group_id = 0;
+    begin_ps = duration = program_id = group_id = 0;
     hlo_op_name.clear();
     hlo_instruction = nullptr;
   }
 };
 
+// Adds one occurrence of a device op that began at <begin_ps> to
+// <time_sliced_builder>, if any.
+void AddOpToTimeSlice(TimeSlicedOpMetricsDbBuilder* time_sliced_builder,
+                      uint64_t begin_ps, uint64_t program_id,
+                      absl::string_view name, absl::string_view category,
+                      uint64_t time_ps, int64_t flops, int64_t bytes_accessed,
+                      int64_t model_flops) {
+  if (time_sliced_builder == nullptr) return;
+  OpMetrics op_metrics;
+  op_metrics.set_hlo_module_id(program_id);
+  op_metrics.set_name(std::string(name));
+  op_metrics.set_category(std::string(category));
+  op_metrics.set_occurrences(1);
+  op_metrics.set_time_ps(time_ps);
+  op_metrics.set_self_time_ps(time_ps);
+  op_metrics.set_flops(flops);
+  op_metrics.set_model_flops(model_flops == 0 ? flops : model_flops);
+  op_metrics.set_bytes_accessed(bytes_accessed);
+  time_sliced_builder->AddOpMetrics(begin_ps, op_metrics);
+}
+
 // Type of a TensorFlow Op activity, which is either beginning or ending an Op.
 enum TfActivityType { kTfOpBegin, kTfOpEnd };
 
@@ -106,13 +128,12 @@ void ProcessOneTfActivity(const TfActivity& activity,
   uint32 tf_op_id = activity.tf_op_id;
   switch (activity.activity_type) {
     case kTfOpBegin: {
-      tf_op_stack->Push(tf_op_id,
-                        std::make_unique<TfOpInfo>(activity.timestamp_ps));
+      tf_op_stack->Push(tf_op_id, TfOpInfo(activity.timestamp_ps));
       break;
     }
     case kTfOpEnd: {
-      std::unique_ptr<TfOpInfo> info = tf_op_stack->Pop(tf_op_id);
-      if (info == nullptr) {
+      std::optional<TfOpInfo> info = tf_op_stack->Pop(tf_op_id);
+      if (!info.has_value()) {
         // This happens if TraceMes overlap.
         VLOG(1) << "No begin event found for TF activity id=" << tf_op_id
                 << " name=" << activity.tf_op.name
@@ -243,7 +264,8 @@ OpMetricsDb ConvertHostThreadsXPlaneToOpMetricsDb(const XPlane& host_trace) {
 }
 
 OpMetricsDb ConvertTpuDeviceTraceXPlaneToOpMetricsDb(
-    const XPlane& device_trace) {
+    const XPlane& device_trace,
+    TimeSlicedOpMetricsDbBuilder* time_sliced_builder) {
   XPlaneVisitor plane = tsl::profiler::CreateTfXPlaneVisitor(&device_trace);
   XEventsOpMetricsDbBuilder builder;
   uint64_t first_op_timestamp_ps = std::numeric_limits<uint64_t>::max();
@@ -261,7 +283,21 @@ OpMetricsDb ConvertTpuDeviceTraceXPlaneToOpMetricsDb(
         op_metrics.set_time_ps(parent.device_timespan.duration_ps());
         op_metrics.set_self_time_ps(op_metrics.time_ps() -
                                     parent.children_duration_ps);
-        builder.AddOpMetric(op_metrics, GetOpKeyFromXEvent(parent.event));
+        XEventsOpMetricsDbBuilder::OpKey key = GetOpKeyFromXEvent(parent.event);
+        if (builder.AddOpMetric(op_metrics, key) &&
+            time_sliced_builder != nullptr) {
+          // Flops and bytes accessed of an XEvent are per occurrence.
+          const uint64_t occurrences = op_metrics.occurrences();
+          op_metrics.set_flops(op_metrics.flops() * occurrences);
+          op_metrics.set_model_flops(
+              op_metrics.model_flops() > 0
+                  ? op_metrics.model_flops() * occurrences
+                  : op_metrics.flops());
+          op_metrics.set_bytes_accessed(op_metrics.bytes_accessed() *
+                                        occurrences);
+          time_sliced_builder->AddOpMetrics(
+              parent.device_timespan.begin_ps(), op_metrics);
+        }
       },
       [](const ParentReference& parent, const ParentReference& child) {
         return parent.device_timespan.Includes(child.device_timespan);
@@ -295,11 +331,17 @@ OpMetricsDb ConvertTpuDeviceTraceXPlaneToOpMetricsDb(
   return builder.Finalize(last_op_timestamp_ps - first_op_timestamp_ps);
 }
 
-void AggregateHloFunc(HLOTracker& current, DeviceOpMetricsDbBuilder& metricDb) {
+void AggregateHloFunc(HLOTracker& current, DeviceOpMetricsDbBuilder& metricDb,
+                      TimeSlicedOpMetricsDbBuilder* time_sliced_builder) {
   if (current.hlo_instruction == nullptr) return;
   auto performance_info_wrapper =
       current.hlo_instruction->GetPerformanceInfoWrapper();
   if (performance_info_wrapper != nullptr) {
+    AddOpToTimeSlice(time_sliced_builder, current.begin_ps, current.program_id,
+                     current.hlo_op_name, current.hlo_instruction->Category(),
+                     current.duration, performance_info_wrapper->DeviceFlops(),
+                     performance_info_wrapper->bytes_accessed(),
+                     performance_info_wrapper->ModelFlops());
     metricDb.EnterOp(
         current.program_id, current.hlo_op_name,
         current.hlo_instruction->Category(),
@@ -315,6 +357,10 @@ void AggregateHloFunc(HLOTracker& current, DeviceOpMetricsDbBuilder& metricDb) {
         current.hlo_instruction->Expression(),
         current.hlo_instruction->SourceInfo());
   } else {
+    AddOpToTimeSlice(time_sliced_builder, current.begin_ps, current.program_id,
+                     current.hlo_op_name, current.hlo_instruction->Category(),
+                     current.duration, /*flops=*/0, /*bytes_accessed=*/0,
+                     /*model_flops=*/0);
     metricDb.EnterOp(current.program_id, current.hlo_op_name,
                      current.hlo_instruction->Category(),
                      current.hlo_instruction->TfOpName(),
@@ -329,7 +375,8 @@ void AggregateHloFunc(HLOTracker& current, DeviceOpMetricsDbBuilder& metricDb) {
 }
 
 OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
-    const XPlane& device_trace, const HloModuleMap& hlo_module_map) {
+    const XPlane& device_trace, const HloModuleMap& hlo_module_map,
+    TimeSlicedOpMetricsDbBuilder* time_sliced_builder) {
   OpMetricsDb result;
   DeviceOpMetricsDbBuilder device_op_metrics_db_builder(&result);
 
@@ -338,6 +385,7 @@ OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
   int64_t num_tf_ops = 0;
 
   XPlaneVisitor plane = tsl::profiler::CreateTfXPlaneVisitor(&device_trace);
+  GpuEventStatTypes stat_types(device_trace);
   HLOTracker current;
   plane.ForEachLine([&](const XLineVisitor& line) {
     if (tsl::profiler::IsDerivedThreadId(line.Id())) return;
@@ -345,16 +393,20 @@ OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
       first_op_offset_ps = std::min(first_op_offset_ps, event.OffsetPs());
       last_op_offset_ps = std::max(last_op_offset_ps, event.EndOffsetPs());
 
-      GpuEventStats stats(&event);
+      GpuEventStats stats(&event, stat_types);
       if (stats.IsXlaOp()) {
         const auto* hlo_instruction = GetHloInstruction(
             hlo_module_map, stats.program_id, stats.hlo_op_names.back());
         if (hlo_instruction != nullptr) {
           if (stats.hlo_op_names.back() != current.hlo_op_name ||
               stats.group_id != current.group_id) {
-            AggregateHloFunc(current, device_op_metrics_db_builder);
+            AggregateHloFunc(current, device_op_metrics_db_builder,
+                             time_sliced_builder);
           }
           // Merge identical and contiguous HLOs.
+          if (current.hlo_instruction == nullptr) {
+            current.begin_ps = event.TimestampPs();
+          }
           current.hlo_instruction = hlo_instruction;
           current.hlo_op_name = stats.hlo_op_names.back();
           current.duration += event.DurationPs();
@@ -365,13 +417,18 @@ OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
           }
         }
       } else if (stats.IsTfOp()) {
-        AggregateHloFunc(current, device_op_metrics_db_builder);
+        AggregateHloFunc(current, device_op_metrics_db_builder,
+                         time_sliced_builder);
         tsl::profiler::TfOp tf_op =
             tsl::profiler::ParseTfOpFullname(stats.tf_op_fullname);
         if (tf_op.category != tsl::profiler::Category::kUnknown) {
           num_tf_ops++;
         }
         std::string name = absl::StrCat(tf_op.name, "/", event.Name());
+        AddOpToTimeSlice(time_sliced_builder, event.TimestampPs(),
+                         /*program_id=*/0, name, tf_op.type,
+                         event.DurationPs(), /*flops=*/0,
+                         /*bytes_accessed=*/0, /*model_flops=*/0);
         device_op_metrics_db_builder.EnterOp(
             /*program_id=*/0,
             /**name=*/name,
@@ -390,7 +447,8 @@ OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
           << "individual TfOp peak flops and bytes accessed estimates, "
           << "please open an issue on GitHub at openxla/xprof.";
     }
-    AggregateHloFunc(current, device_op_metrics_db_builder);
+    AggregateHloFunc(current, device_op_metrics_db_builder,
+                     time_sliced_builder);
   });
   SetTotalTimePs(
       result, last_op_offset_ps ? last_op_offset_ps - first_op_offset_ps : 0);
@@ -57,12 +57,18 @@ OpMetricsDb ConvertHostThreadsXPlaneToOpMetricsDb(const XPlane& host_trace);
 
 // Converts GPU device trace to OpMetricsDb.
 // Will use HloModuleMap to source performance info for cost analysis.
+// If <time_sliced_builder> is not null, the ops are also added to it in the
+// same pass.
 OpMetricsDb ConvertDeviceTraceXPlaneToOpMetricsDb(
-    const XPlane& device_trace, const HloModuleMap& hlo_module_map);
+    const XPlane& device_trace, const HloModuleMap& hlo_module_map,
+    TimeSlicedOpMetricsDbBuilder* time_sliced_builder = nullptr);
 
-// Convert TPU DeviceTrace XPlane to OpMetricDb
+// Convert TPU DeviceTrace XPlane to OpMetricDb.
+// If <time_sliced_builder> is not null, the ops are also added to it in the
+// same pass.
 OpMetricsDb ConvertTpuDeviceTraceXPlaneToOpMetricsDb(
-    const XPlane& device_trace);
+    const XPlane& device_trace,
+    TimeSlicedOpMetricsDbBuilder* time_sliced_builder = nullptr);
 
 }  // namespace profiler
 }  // namespace tensorflow
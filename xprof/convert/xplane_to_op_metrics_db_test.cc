@@ -33,6 +33,7 @@ limitations under the License.
 #include "xla/tsl/profiler/utils/xplane_schema.h"
 #include "xla/tsl/profiler/utils/xplane_test_utils.h"
 #include "tsl/profiler/protobuf/xplane.pb.h"
+#include "xprof/convert/op_metrics_db_combiner.h"
 #include "plugin/xprof/protobuf/op_metrics.pb.h"
 #include "xprof/utils/hlo_cost_analysis_wrapper.h"
 #include "xprof/utils/hlo_module_map.h"
@@ -277,6 +278,53 @@ TEST(ConvertXPlaneToOpMetricsDb, TpuDeviceOpMetricsDb) {
 #endif
 }
 
+TEST(ConvertXPlaneToOpMetricsDb, TpuDeviceOpMetricsDbTimeSlices) {
+  XSpace xspace;
+  XPlane* xplane = tsl::profiler::GetOrCreateTpuXPlane(
+      &xspace, /*device_ordinal=*/0, "TPU V4",
+      /*peak_tera_flops_per_second=*/0,
+      /*peak_hbm_bw_gigabytes_per_second=*/0);
+  XPlaneBuilder device_plane(xplane);
+  XLineBuilder stream1 = device_plane.GetOrCreateLine(/*line_id=*/10);
+  stream1.SetName(tsl::profiler::kTensorFlowOpLineName);
+  AddTensorFlowTpuOpEvent("MatMul", "while:MatMul", 0, 10, "MatMul", 34, 45, 1,
+                          5, 1, 1, &device_plane, &stream1);
+  AddTensorFlowTpuOpEvent("Add", "while:Add", 20, 10, "Add", 2, 8, 1, 5, 1, 2,
+                          &device_plane, &stream1);
+  XEventBuilder matmul =
+      stream1.AddEvent(*device_plane.GetOrCreateEventMetadata("MatMul"));
+  matmul.SetTimestampNs(100);
+  matmul.SetDurationNs(10);
+  matmul.SetNumOccurrences(1);
+  TimeSlicedOpMetricsDbBuilder time_sliced_builder(
+      /*slice_duration_ps=*/tsl::profiler::NanoToPico(50));
+  OpMetricsDb op_metrics =
+      ConvertTpuDeviceTraceXPlaneToOpMetricsDb(*xplane, &time_sliced_builder);
+  TimeSlicedOpMetricsDb time_sliced = time_sliced_builder.Finalize();
+
+  ASSERT_EQ(time_sliced.slices_size(), 2);
+  const OpMetricsDbSlice& slice_0 = time_sliced.slices(0);
+  EXPECT_EQ(slice_0.begin_ps(), 0);
+  ASSERT_EQ(slice_0.op_metrics_db().metrics_db_size(), 2);
+  EXPECT_EQ(slice_0.op_metrics_db().total_op_time_ps(),
+            tsl::profiler::NanoToPico(20));
+  const OpMetricsDbSlice& slice_1 = time_sliced.slices(1);
+  EXPECT_EQ(slice_1.begin_ps(), tsl::profiler::NanoToPico(100));
+  ASSERT_EQ(slice_1.op_metrics_db().metrics_db_size(), 1);
+  const OpMetrics& matmul = slice_1.op_metrics_db().metrics_db(0);
+  EXPECT_EQ(matmul.name(), "MatMul");
+  EXPECT_EQ(matmul.occurrences(), 1);
+  EXPECT_EQ(matmul.time_ps(), tsl::profiler::NanoToPico(10));
+  EXPECT_EQ(matmul.flops(), 34);
+
+  // The slices add up to the session-wide OpMetricsDb.
+  uint64 sliced_op_time_ps = 0;
+  for (const OpMetricsDbSlice& slice : time_sliced.slices()) {
+    sliced_op_time_ps += slice.op_metrics_db().total_op_time_ps();
+  }
+  EXPECT_EQ(sliced_op_time_ps, op_metrics.total_op_time_ps());
+}
+
 TEST(ConvertXPlaneToOpMetricsDb, HostXPlaneWithXlaOps) {
   XPlane xplane;
   XPlaneBuilder plane(&xplane);
@@ -18,10 +18,12 @@ limitations under the License.
 #include <sys/types.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/cleanup/cleanup.h"
@@ -116,8 +118,8 @@ PerfEnv MakePerfEnvForGpu(double peak_tera_flops_per_second,
 }
 
 PerfEnv GetPerfEnvFromXPlane(const XPlane& device_plane) {
-  DeviceCapabilities cap = GetDeviceCaps(device_plane);
   if (!absl::StartsWith(device_plane.name(), kTpuPlanePrefix)) {
+    DeviceCapabilities cap = GetDeviceCaps(device_plane);
     double peak_tera_flops_per_second =
         cap.num_cores() *
         tsl::profiler::GigaToTera(GetFlopMaxThroughputPerSM(cap));
@@ -133,73 +135,51 @@ PerfEnv GetPerfEnvFromXPlane(const XPlane& device_plane) {
                               /*SRAM_RD=*/shm_giga_bytes_per_second,
                               /*SRAM_WR=*/shm_giga_bytes_per_second});
   } else {
+    double peak_tera_flops_per_second = 0.0;
+    // Indexed by MemBwType, from HBM_RW to VMEM_WR.
+    std::vector<double> peak_bws(MemBwType::MEM_BW_TYPE_VMEM_WR + 1, 0.0);
+    bool has_megacore = false;
+    bool has_merged_vmem = false;
+    // Reads all the device capabilities in a single pass over the plane stats
+    // instead of looking each of them up separately.
     XPlaneVisitor visitor = tsl::profiler::CreateTfXPlaneVisitor(&device_plane);
-    std::optional<XStatVisitor> peak_tera_flops_per_second =
-        visitor.GetStat(StatType::kDevCapPeakTeraflopsPerSecond);
-    double peak_tera_flops_per_second_val =
-        peak_tera_flops_per_second.has_value()
-            ? peak_tera_flops_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> peak_hbm_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakHbmBwGigabytesPerSecond);
-    double peak_hbm_bw_giga_bytes_per_second_val =
-        peak_hbm_bw_giga_bytes_per_second.has_value()
-            ? peak_hbm_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> peak_sram_rd_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakSramRdBwGigabytesPerSecond);
-    double peak_sram_rd_bw_giga_bytes_per_second_val =
-        peak_sram_rd_bw_giga_bytes_per_second.has_value()
-            ? peak_sram_rd_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> peak_sram_wr_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakSramWrBwGigabytesPerSecond);
-    double peak_sram_wr_bw_giga_bytes_per_second_val =
-        peak_sram_wr_bw_giga_bytes_per_second.has_value()
-            ? peak_sram_wr_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> cmem_rd_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakCmemRdBwGigabytesPerSecond);
-    double cmem_rd_bw_giga_bytes_per_second_val =
-        cmem_rd_bw_giga_bytes_per_second.has_value()
-            ? cmem_rd_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> cmem_wr_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakCmemWrBwGigabytesPerSecond);
-    double cmem_wr_bw_giga_bytes_per_second_val =
-        cmem_wr_bw_giga_bytes_per_second.has_value()
-            ? cmem_wr_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> vmem_rd_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakVmemRdBwGigabytesPerSecond);
-    double vmem_rd_bw_giga_bytes_per_second_val =
-        vmem_rd_bw_giga_bytes_per_second.has_value()
-            ? vmem_rd_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> vmem_wr_bw_giga_bytes_per_second =
-        visitor.GetStat(StatType::kDevCapPeakVmemWrBwGigabytesPerSecond);
-    double vmem_wr_bw_giga_bytes_per_second_val =
-        vmem_wr_bw_giga_bytes_per_second.has_value()
-            ? vmem_wr_bw_giga_bytes_per_second->DoubleValue()
-            : 0.0;
-    std::optional<XStatVisitor> has_megacore =
-        visitor.GetStat(StatType::kDevHasMegacore);
-    bool has_megacore_val =
-        has_megacore.has_value() ? has_megacore->BoolValue() : false;
-    std::optional<XStatVisitor> has_merged_vmem =
-        visitor.GetStat(StatType::kDevHasMergedVmem);
-    bool has_merged_vmem_val =
-        has_merged_vmem.has_value() ? has_merged_vmem->BoolValue() : false;
-    return MakePerfEnvForTpu(
-        peak_tera_flops_per_second_val,
-        {/*HBM_RW=*/peak_hbm_bw_giga_bytes_per_second_val,
-         /*SRAM_RD=*/peak_sram_rd_bw_giga_bytes_per_second_val,
-         /*SRAM_WR=*/peak_sram_wr_bw_giga_bytes_per_second_val,
-         /**CMEM_RD=*/cmem_rd_bw_giga_bytes_per_second_val,
-         /**CMEM_WR=*/cmem_wr_bw_giga_bytes_per_second_val,
-         /**VMEM_RD=*/vmem_rd_bw_giga_bytes_per_second_val,
-         /**VMEM_WR=*/vmem_wr_bw_giga_bytes_per_second_val},
-        has_merged_vmem_val, has_megacore_val);
+    visitor.ForEachStat([&](const XStatVisitor& stat) {
+      if (!stat.Type().has_value()) return;
+      switch (stat.Type().value()) {
+        case StatType::kDevCapPeakTeraflopsPerSecond:
+          peak_tera_flops_per_second = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakHbmBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_HBM_RW] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakSramRdBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_SRAM_RD] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakSramWrBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_SRAM_WR] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakCmemRdBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_CMEM_RD] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakCmemWrBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_CMEM_WR] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakVmemRdBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_VMEM_RD] = stat.DoubleValue();
+          break;
+        case StatType::kDevCapPeakVmemWrBwGigabytesPerSecond:
+          peak_bws[MemBwType::MEM_BW_TYPE_VMEM_WR] = stat.DoubleValue();
+          break;
+        case StatType::kDevHasMegacore:
+          has_megacore = stat.BoolValue();
+          break;
+        case StatType::kDevHasMergedVmem:
+          has_merged_vmem = stat.BoolValue();
+          break;
+      }
+    });
+    return MakePerfEnvForTpu(peak_tera_flops_per_second, std::move(peak_bws),
+                             has_merged_vmem, has_megacore);
   }
 }
 
@@ -348,18 +328,31 @@ OpStats ConvertXSpaceToOpStats(const XSpace& space,
 
     // OpMetricDb Generation.
     std::vector<OpMetricsDb> all_op_metrics_dbs;
+    std::vector<TimeSlicedOpMetricsDb> all_time_sliced_op_metrics_dbs;
+    const uint64_t slice_duration_ps = options.op_metrics_db_slice_duration_ps;
 
     // Ensure op_metrics threads are joined and results combined when the
     // function exits.
-    auto op_metrics_cleanup =
-        absl::MakeCleanup([&all_op_metrics_dbs, &op_metrics_db_combiner]() {
+    auto op_metrics_cleanup = absl::MakeCleanup(
+        [&all_op_metrics_dbs, &op_metrics_db_combiner,
+         &all_time_sliced_op_metrics_dbs, slice_duration_ps, &op_stats]() {
           for (auto& op_metrics_db : all_op_metrics_dbs) {
             op_metrics_db_combiner.Combine(op_metrics_db);
           }
+          if (all_time_sliced_op_metrics_dbs.empty()) return;
+          TimeSlicedOpMetricsDbBuilder time_sliced_builder(slice_duration_ps);
+          for (const auto& time_sliced_db : all_time_sliced_op_metrics_dbs) {
+            time_sliced_builder.Combine(time_sliced_db);
+          }
+          *op_stats.mutable_time_sliced_device_op_metrics_db() =
+              time_sliced_builder.Finalize();
         });
 
     if (options.generate_op_metrics_db) {
       all_op_metrics_dbs.resize(device_planes.size());  // Resize here
+      if (slice_duration_ps > 0) {
+        all_time_sliced_op_metrics_dbs.resize(device_planes.size());
+      }
 
       if (!device_planes.empty() && !op_stats.has_perf_env()) {
         *op_stats.mutable_perf_env() = GetPerfEnvFromXPlane(*device_planes[0]);
@@ -367,21 +360,35 @@ OpStats ConvertXSpaceToOpStats(const XSpace& space,
       for (size_t i = 0; i < device_planes.size(); ++i) {
         const XPlane* device_plane = device_planes[i];
         OpMetricsDb& op_metrics_db = all_op_metrics_dbs[i];
+        TimeSlicedOpMetricsDb* time_sliced_db =
+            slice_duration_ps > 0 ? &all_time_sliced_op_metrics_dbs[i]
+                                  : nullptr;
         executor->Execute([device_plane, &hlo_module_map, is_tpu,
-                           &op_metrics_db]() {
+                           &op_metrics_db, time_sliced_db,
+                           slice_duration_ps]() {
+          std::optional<TimeSlicedOpMetricsDbBuilder> time_sliced_builder;
+          if (time_sliced_db != nullptr) {
+            time_sliced_builder.emplace(slice_duration_ps);
+          }
+          TimeSlicedOpMetricsDbBuilder* time_sliced_builder_ptr =
+              time_sliced_builder.has_value() ? &*time_sliced_builder
+                                              : nullptr;
           if (!is_tpu) {
             op_metrics_db = ConvertDeviceTraceXPlaneToOpMetricsDb(
-                *device_plane, hlo_module_map);
+                *device_plane, hlo_module_map, time_sliced_builder_ptr);
           } else {
             // TODO(b/397774568): Remove this once the SparseCore
             // OpMetricsDb is implemented.
             if (!tsl::profiler::GetSparseCoreId(device_plane->name())
                      .has_value()) {
-              op_metrics_db =
-                  ConvertTpuDeviceTraceXPlaneToOpMetricsDb(*device_plane);
+              op_metrics_db = ConvertTpuDeviceTraceXPlaneToOpMetricsDb(
+                  *device_plane, time_sliced_builder_ptr);
               UpdateOpMetricsDbFromHloModuleMap(op_metrics_db, hlo_module_map);
             }
           }
+          if (time_sliced_builder.has_value()) {
+            *time_sliced_db = time_sliced_builder->Finalize();
+          }
         });
       }
     }
@@ -517,9 +524,11 @@ OpStats ConvertXSpaceToOpStats(const XSpace& space,
                           // The cleanup blocks will execute after this step.
   }
 
+  // A single tracker is shared by all modules so that ops that appear in
+  // several programs are only classified once.
+  ModelTracker model_tracker;
   for (const auto& [program_id, hlo_module] : hlo_module_map) {
-    ModelTracker model_tracker;
-    model_tracker.ProcessHloModule(hlo_module);
+    model_tracker.ProcessHloModule(hlo_module, /*return_on_training=*/true);
     if (model_tracker.IsTraining()) {
       op_stats.mutable_run_environment()->set_is_training(true);
       break;
@@ -559,11 +568,8 @@ OpStats ConvertXSpaceToOpStats(const XSpace& space,
       op_stats.mutable_performance_counter_result()
           ->set_matrix_unit_utilization_percent(stat->DoubleValue());
     }
-    TfFunctionDb* tf_function_db = op_stats.mutable_tf_function_db();
-    visitor.ForEachLine([&](const XLineVisitor& line) {
-      CombineTfFunctionDb(ConvertHostThreadsXLineToTfFunctionDb(line),
-                          tf_function_db);
-    });
+    *op_stats.mutable_tf_function_db() =
+        ConvertHostThreadsXPlaneToTfFunctionDb(visitor);
   }
   if (options.generate_step_db) {
     if (is_tpu) {
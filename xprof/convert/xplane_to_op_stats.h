@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef XPROF_CONVERT_XPLANE_TO_OP_STATS_H_
 #define XPROF_CONVERT_XPLANE_TO_OP_STATS_H_
 
+#include <cstdint>
 #include <vector>
 
 #include "tsl/profiler/protobuf/xplane.pb.h"
@@ -31,6 +32,9 @@ struct OpStatsOptions {
   bool generate_op_metrics_db = false;
   bool generate_step_db = false;
   bool generate_kernel_stats_db = false;
+  // If non-zero (and generate_op_metrics_db is set), also buckets the device
+  // op metrics into slices of this duration.
+  uint64_t op_metrics_db_slice_duration_ps = 0;
 };
 
 // NOTE: call GroupTfEvents before if OpStats.step_db needs to be generated.
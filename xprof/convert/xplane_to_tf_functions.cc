@@ -16,6 +16,8 @@ limitations under the License.
 #include "xprof/convert/xplane_to_tf_functions.h"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 #include <stack>
@@ -24,6 +26,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
@@ -36,6 +39,7 @@ limitations under the License.
 #include "xla/tsl/profiler/utils/xplane_schema.h"
 #include "tsl/platform/protobuf.h"
 #include "tsl/profiler/protobuf/xplane.pb.h"
+#include "xprof/convert/xprof_thread_pool_executor.h"
 #include "plugin/xprof/protobuf/tf_function.pb.h"
 
 namespace tensorflow {
@@ -82,7 +86,8 @@ double ComputeExpensiveCallPercent(const TfFunction& tf_function) {
 
 // Each invocation of a tf-function creates an ActivationRecord.
 struct ActivationRecord {
-  std::string function_name;               // name of the tf-function.
+  int64_t metadata_id;                     // metadata ID of the tf-function.
+  absl::string_view function_name;         // name of the tf-function.
   tsl::profiler::Timespan timespan;        // timespan of this invocation.
   TfFunctionExecutionMode execution_mode;  // execution mode.
   TfFunctionCompiler compiler;             // compiler used.
@@ -91,16 +96,17 @@ struct ActivationRecord {
   uint64 children_duration_ps;  // Sum of the duration of all (immediate)
                                 // children tf-functions of this function.
   ActivationRecord()
-      : function_name(""),
+      : metadata_id(0),
         execution_mode(INVALID_MODE),
         compiler(INVALID_COMPILER),
         tracing_count(0),
         children_duration_ps(0) {}
-  ActivationRecord(absl::string_view name,
+  ActivationRecord(int64_t metadata_id, absl::string_view name,
                    const tsl::profiler::Timespan& timespan,
                    TfFunctionExecutionMode exe_mode,
                    TfFunctionCompiler compiler, int64_t tracing_cnt)
-      : function_name(std::string(name)),
+      : metadata_id(metadata_id),
+        function_name(name),
         timespan(timespan),
         execution_mode(exe_mode),
         compiler(compiler),
@@ -139,6 +145,32 @@ TfFunctionCompiler CombineCompilers(TfFunctionCompiler a,
   return MIXED_COMPILER;
 }
 
+// Statistics of a tf-function accumulated over its invocations.
+struct TfFunctionStats {
+  struct ModeMetrics {
+    uint64 count = 0;
+    uint64 self_time_ps = 0;
+  };
+  absl::string_view function_name;
+  int64_t total_tracing_count = 0;
+  TfFunctionCompiler compiler = INVALID_COMPILER;
+  std::array<ModeMetrics, TfFunctionExecutionMode_ARRAYSIZE> metrics;
+
+  void Combine(const TfFunctionStats& src) {
+    total_tracing_count =
+        std::max(total_tracing_count, src.total_tracing_count);
+    compiler = CombineCompilers(compiler, src.compiler);
+    for (int mode = 0; mode < TfFunctionExecutionMode_ARRAYSIZE; ++mode) {
+      metrics[mode].count += src.metrics[mode].count;
+      metrics[mode].self_time_ps += src.metrics[mode].self_time_ps;
+    }
+  }
+};
+
+// Map from the event metadata ID of a tf-function to its statistics. Event
+// metadata IDs are only unique within an XPlane.
+using TfFunctionStatsMap = absl::flat_hash_map<int64_t, TfFunctionStats>;
+
 void CombineTfFunctionMetrics(const TfFunctionMetrics& src,
                               TfFunctionMetrics* dst) {
   dst->set_count(src.count() + dst->count());
@@ -188,9 +220,9 @@ class TfFunctionExecutions {
       int64_t index = activations_.size();
       auto timespan = event.GetTimespan();
       auto mode_compiler = Decode(event.Name(), mode);
-      ActivationRecord activation_record =
-          ActivationRecord(event.Name(), timespan, mode_compiler.first,
-                           mode_compiler.second, tracing_count);
+      ActivationRecord activation_record = ActivationRecord(
+          event.Id(), event.Name(), timespan, mode_compiler.first,
+          mode_compiler.second, tracing_count);
       activations_.push_back(activation_record);
       EntryOrExit entry_point =
           EntryOrExit(/*is_entry=*/true, index, timespan.begin_ps());
@@ -224,30 +256,24 @@ class TfFunctionExecutions {
     return result;
   }
 
-  // Converts this execution history to a TfFunctionDb.
-  TfFunctionDb ConvertToTfFunctionDb() {
-    TfFunctionDb result;
+  // Accumulates this execution history into <stats>.
+  void AccumulateStats(TfFunctionStatsMap* stats) const {
     for (const auto& record : activations_) {
-      TfFunction* fun = &(*result.mutable_tf_functions())[record.function_name];
-      fun->set_total_tracing_count(
-          std::max(static_cast<int64_t>(fun->total_tracing_count()),
-                   record.tracing_count));
-      fun->set_compiler(CombineCompilers(fun->compiler(), record.compiler));
+      TfFunctionStats& fun = (*stats)[record.metadata_id];
+      fun.function_name = record.function_name;
+      fun.total_tracing_count =
+          std::max(fun.total_tracing_count, record.tracing_count);
+      fun.compiler = CombineCompilers(fun.compiler, record.compiler);
       // The self-time of this function is the difference between the duration
       // of this function and the duration of its children.
       uint64 self_time_ps =
           record.timespan.duration_ps() - record.children_duration_ps;
       // Updates the metrics for this execution mode with this invocation.
-      TfFunctionMetrics* metrics =
-          &(*fun->mutable_metrics())[record.execution_mode];
-      metrics->set_count(metrics->count() + 1);
-      metrics->set_self_time_ps(metrics->self_time_ps() + self_time_ps);
-    }
-    for (auto& name_fun : *result.mutable_tf_functions()) {
-      TfFunction& fun = name_fun.second;
-      fun.set_expensive_call_percent(ComputeExpensiveCallPercent(fun));
+      TfFunctionStats::ModeMetrics& metrics =
+          fun.metrics[record.execution_mode];
+      metrics.count++;
+      metrics.self_time_ps += self_time_ps;
     }
-    return result;
   }
 
   // Calculates the children duration of every tf-function.
@@ -278,6 +304,32 @@ class TfFunctionExecutions {
   std::vector<EntryOrExit> points_;
 };
 
+// Converts the accumulated statistics to a TfFunctionDb.
+TfFunctionDb ConvertToTfFunctionDb(const TfFunctionStatsMap& stats) {
+  TfFunctionDb result;
+  for (const auto& id_stats : stats) {
+    const TfFunctionStats& fun_stats = id_stats.second;
+    TfFunction fun;
+    fun.set_total_tracing_count(fun_stats.total_tracing_count);
+    fun.set_compiler(fun_stats.compiler);
+    for (int mode = 0; mode < TfFunctionExecutionMode_ARRAYSIZE; ++mode) {
+      if (fun_stats.metrics[mode].count == 0) continue;
+      TfFunctionMetrics& metrics = (*fun.mutable_metrics())[mode];
+      metrics.set_count(fun_stats.metrics[mode].count);
+      metrics.set_self_time_ps(fun_stats.metrics[mode].self_time_ps);
+    }
+    // Different event metadata may share the same tf-function name.
+    auto [it, inserted] = result.mutable_tf_functions()->insert(
+        {std::string(fun_stats.function_name), fun});
+    if (!inserted) CombineTfFunction(fun, &it->second);
+  }
+  for (auto& name_fun : *result.mutable_tf_functions()) {
+    TfFunction& fun = name_fun.second;
+    fun.set_expensive_call_percent(ComputeExpensiveCallPercent(fun));
+  }
+  return result;
+}
+
 }  // namespace
 
 std::string DebugString(const TfFunctionDb& tf_function_db) {
@@ -301,8 +353,39 @@ void CombineTfFunctionDb(const TfFunctionDb& src, TfFunctionDb* dst) {
 }
 
 TfFunctionDb ConvertHostThreadsXLineToTfFunctionDb(const XLineVisitor& line) {
-  TfFunctionExecutions tf_function_executions = TfFunctionExecutions(line);
-  return tf_function_executions.ConvertToTfFunctionDb();
+  TfFunctionStatsMap stats;
+  TfFunctionExecutions(line).AccumulateStats(&stats);
+  return ConvertToTfFunctionDb(stats);
+}
+
+TfFunctionDb ConvertHostThreadsXPlaneToTfFunctionDb(
+    const XPlaneVisitor& plane) {
+  std::vector<XLineVisitor> lines;
+  lines.reserve(plane.NumLines());
+  plane.ForEachLine(
+      [&lines](const XLineVisitor& line) { lines.push_back(line); });
+  std::vector<TfFunctionStatsMap> line_stats(lines.size());
+  if (lines.size() > 1) {
+    XprofThreadPoolExecutor executor("tf_function_threads");
+    for (size_t i = 0; i < lines.size(); ++i) {
+      executor.Execute([&line = lines[i], &stats = line_stats[i]]() {
+        TfFunctionExecutions(line).AccumulateStats(&stats);
+      });
+    }
+    executor.JoinAll();
+  } else if (lines.size() == 1) {
+    TfFunctionExecutions(lines[0]).AccumulateStats(&line_stats[0]);
+  }
+  // All lines share the event metadata of the plane, so the per-line stats are
+  // reduced by metadata ID before they are converted to a TfFunctionDb.
+  TfFunctionStatsMap stats;
+  for (const TfFunctionStatsMap& src : line_stats) {
+    for (const auto& [metadata_id, src_stats] : src) {
+      auto [it, inserted] = stats.try_emplace(metadata_id, src_stats);
+      if (!inserted) it->second.Combine(src_stats);
+    }
+  }
+  return ConvertToTfFunctionDb(stats);
 }
 
 }  // namespace profiler
@@ -26,11 +26,17 @@ namespace profiler {
 
 using tsl::profiler::XEventVisitor;
 using tsl::profiler::XLineVisitor;
+using tsl::profiler::XPlaneVisitor;
 using tsl::profiler::XStatVisitor;
 
 // Converts from the given XLine to a TfFunctionDb.
 TfFunctionDb ConvertHostThreadsXLineToTfFunctionDb(const XLineVisitor& line);
 
+// Converts all the lines of the given host XPlane to a single TfFunctionDb.
+// Lines are processed in parallel and their statistics are reduced by event
+// metadata ID.
+TfFunctionDb ConvertHostThreadsXPlaneToTfFunctionDb(const XPlaneVisitor& plane);
+
 // Returns a debugging string for the given TfFunctionDb.
 std::string DebugString(TfFunctionDb tf_function_db);
 
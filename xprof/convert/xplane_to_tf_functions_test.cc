@@ -186,6 +186,45 @@ TEST(ConvertXPlaneToTfFunctions, EagerPlusConcrete) {
   EXPECT_EQ(concrete_mode.self_time_ps(), 40);
 }
 
+TEST(ConvertXPlaneToTfFunctions, PlaneMatchesCombinedLines) {
+  XSpace space;
+  XPlaneBuilder host_plane_builder(space.add_planes());
+  host_plane_builder.SetName(kHostThreadsPlaneName);
+  constexpr int kNumThreads = 8;
+  host_plane_builder.ReserveLines(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    auto thread = host_plane_builder.GetOrCreateLine(i);
+    CreateTfFunctionCallEvent(&host_plane_builder, &thread, "outer", 10, 100,
+                              kTracedNonXla, i);
+    CreateTfFunctionCallEvent(&host_plane_builder, &thread, "inner", 30, 10 + i,
+                              i % 2 ? kNotTracedXla : kNotTracedNonXla, 1);
+  }
+
+  XPlaneVisitor plane = tsl::profiler::CreateTfXPlaneVisitor(
+      FindPlaneWithName(space, kHostThreadsPlaneName));
+  TfFunctionDb tf_function_db = ConvertHostThreadsXPlaneToTfFunctionDb(plane);
+  TfFunctionDb expected = ConvertXSpaceToTfFunctionDb(space);
+
+  ASSERT_EQ(tf_function_db.tf_functions().size(), 2);
+  for (const auto& [name, expected_fun] : expected.tf_functions()) {
+    ASSERT_EQ(tf_function_db.tf_functions().count(name), 1);
+    const TfFunction& fun = tf_function_db.tf_functions().at(name);
+    EXPECT_EQ(fun.total_tracing_count(), expected_fun.total_tracing_count());
+    EXPECT_EQ(fun.compiler(), expected_fun.compiler());
+    EXPECT_NEAR(fun.expensive_call_percent(),
+                expected_fun.expensive_call_percent(), kMaxError);
+    ASSERT_EQ(fun.metrics().size(), expected_fun.metrics().size());
+    for (const auto& [mode, expected_metrics] : expected_fun.metrics()) {
+      ASSERT_EQ(fun.metrics().count(mode), 1);
+      EXPECT_EQ(fun.metrics().at(mode).count(), expected_metrics.count());
+      EXPECT_EQ(fun.metrics().at(mode).self_time_ps(),
+                expected_metrics.self_time_ps());
+    }
+  }
+  EXPECT_EQ(tf_function_db.tf_functions().at("inner").compiler(),
+            MIXED_COMPILER);
+}
+
 }  // namespace
 }  // namespace profiler
 }  // namespace tensorflow
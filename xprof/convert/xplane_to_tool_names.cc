@@ -54,10 +54,11 @@ bool HasHloProtoMetadata(const XSpace& xspace) {
 absl::StatusOr<std::string> GetAvailableToolNames(
     const SessionSnapshot& session_snapshot) {
   std::vector<std::string> tools;
-  bool is_cloud_vertex_ai = !session_snapshot.HasAccessibleRunDir();
+  // The streaming trace viewer needs somewhere to store its fast file.
+  bool is_streaming_trace = session_snapshot.HasFastFileStorage();
   if (session_snapshot.XSpaceSize() != 0) {
     tools.reserve(11);
-    tools.push_back(is_cloud_vertex_ai ? "trace_viewer" : "trace_viewer@");
+    tools.push_back(is_streaming_trace ? "trace_viewer@" : "trace_viewer");
     tools.push_back("overview_page");
     // TODO(jonahweaver): Re-enable input_pipeline_analyzer when it is ready.
     // b/407096031
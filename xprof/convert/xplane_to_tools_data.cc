@@ -15,31 +15,42 @@ limitations under the License.
 
 #include "xprof/convert/xplane_to_tools_data.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "xla/tsl/lib/io/table_options.h"
 #include "xla/tsl/platform/env.h"
 #include "xla/tsl/platform/errors.h"
 #include "xla/tsl/platform/file_system.h"
 #include "xla/tsl/platform/statusor.h"
 #include "xla/tsl/profiler/convert/xplane_to_trace_events.h"
+#include "xla/tsl/profiler/utils/math_utils.h"
 #include "xla/tsl/profiler/utils/timespan.h"
 #include "xla/tsl/profiler/utils/xplane_schema.h"
 #include "xla/tsl/profiler/utils/xplane_utils.h"
 #include "tsl/platform/protobuf.h"
 #include "tsl/profiler/protobuf/xplane.pb.h"
-#include "xprof/convert/compute_inference_latency.h"
+#include "xprof/convert/data_table_utils.h"
 #include "xprof/convert/hlo_to_tools_data.h"
 #include "xprof/convert/multi_xplanes_to_op_stats.h"
 #include "xprof/convert/multi_xspace_to_inference_stats.h"
+#include "xprof/convert/op_metrics_db_query.h"
+#include "xprof/convert/op_stats_diff.h"
 #include "xprof/convert/op_stats_to_hlo_stats.h"
 #include "xprof/convert/op_stats_to_input_pipeline_analysis.h"
 #include "xprof/convert/op_stats_to_op_profile.h"
@@ -51,7 +62,10 @@ limitations under the License.
 #include "xprof/convert/process_megascale_dcn.h"
 #include "xprof/convert/repository.h"
 #include "xprof/convert/tool_options.h"
+#include "xprof/convert/trace_viewer/legacy_trace_to_json.h"
+#include "xprof/convert/trace_viewer/trace_events.h"
 #include "xprof/convert/trace_viewer/trace_events_to_json.h"
+#include "xprof/convert/trace_viewer/trace_viewer_color.h"
 #include "xprof/convert/trace_viewer/trace_viewer_visibility.h"
 #include "xprof/convert/xplane_to_dcn_collective_stats.h"
 #include "xprof/convert/xplane_to_hlo.h"
@@ -65,12 +79,14 @@ limitations under the License.
 #include "plugin/xprof/protobuf/inference_stats.pb.h"
 #include "plugin/xprof/protobuf/input_pipeline.pb.h"
 #include "plugin/xprof/protobuf/kernel_stats.pb.h"
+#include "plugin/xprof/protobuf/op_metrics.pb.h"
 #include "plugin/xprof/protobuf/op_profile.pb.h"
 #include "plugin/xprof/protobuf/op_stats.pb.h"
 #include "plugin/xprof/protobuf/overview_page.pb.h"
 #include "plugin/xprof/protobuf/roofline_model.pb.h"
 #include "plugin/xprof/protobuf/tf_data_stats.pb.h"
 #include "plugin/xprof/protobuf/tf_stats.pb.h"
+#include "plugin/xprof/protobuf/trace_events_old.pb.h"
 #include "xprof/utils/hardware_type_utils.h"
 
 namespace tensorflow {
@@ -78,6 +94,10 @@ namespace profiler {
 
 namespace {
 
+// Default maximum number of events sent by the non-streaming trace viewer.
+// The "max_events" tool option overrides it; a negative value disables it.
+constexpr int kTraceViewerMaxEvents = 1000000;
+
 struct TraceViewOption {
   uint64_t resolution = 0;
   double start_time_ms = 0.0;
@@ -101,6 +121,78 @@ absl::StatusOr<TraceViewOption> GetTraceViewOption(const ToolOptions& options) {
   return trace_options;
 }
 
+// Parses a comma-separated list of unsigned integers.
+absl::StatusOr<std::vector<uint64_t>> ParseUint64List(absl::string_view list) {
+  std::vector<uint64_t> values;
+  for (absl::string_view item : absl::StrSplit(list, ',', absl::SkipEmpty())) {
+    uint64_t value;
+    if (!absl::SimpleAtoi(item, &value)) {
+      return tsl::errors::InvalidArgument("wrong list argument: ", list);
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+// Reads the layout of the streaming trace viewer table from <options>:
+// "table_block_sizes" and "table_tiles_ps" list the block size in bytes and
+// the time tile width of each zoom level, the last entry applying to the finer
+// levels, and "table_compression" is "snappy" or "none". They only take effect
+// when the table is built.
+absl::StatusOr<TraceTableOptions> GetTraceTableOptions(
+    const ToolOptions& options) {
+  TF_ASSIGN_OR_RETURN(std::vector<uint64_t> block_sizes,
+                      ParseUint64List(GetParamWithDefault<std::string>(
+                          options, "table_block_sizes", "")));
+  TF_ASSIGN_OR_RETURN(std::vector<uint64_t> tiles_ps,
+                      ParseUint64List(GetParamWithDefault<std::string>(
+                          options, "table_tiles_ps", "")));
+  if (absl::c_linear_search(block_sizes, 0)) {
+    return tsl::errors::InvalidArgument("table_block_sizes must be positive");
+  }
+  TraceTableOptions table_options;
+  table_options.levels.resize(std::max(block_sizes.size(), tiles_ps.size()));
+  for (size_t i = 0; i < table_options.levels.size(); ++i) {
+    TraceTableOptions::Level& level = table_options.levels[i];
+    if (!block_sizes.empty()) {
+      level.block_size = block_sizes[std::min(i, block_sizes.size() - 1)];
+    }
+    if (!tiles_ps.empty()) {
+      level.tile_ps = tiles_ps[std::min(i, tiles_ps.size() - 1)];
+    }
+  }
+  std::string compression =
+      GetParamWithDefault<std::string>(options, "table_compression", "snappy");
+  if (compression == "none") {
+    table_options.compression = tsl::table::kNoCompression;
+  } else if (compression != "snappy") {
+    return tsl::errors::InvalidArgument("unknown table_compression: ",
+                                        compression);
+  }
+  return table_options;
+}
+
+// Converts the XSpace of <host_name> to trace events and stores them in a
+// LevelDB table at <sstable_path>. This is the only place where the streaming
+// trace viewer loads the XSpace; later requests read only the table.
+// Event colors are assigned by <colorer> once here and stored in the table.
+absl::Status BuildTraceEventsLevelDbTable(
+    const SessionSnapshot& session_snapshot, const std::string& host_name,
+    const std::string& sstable_path, TraceEventsColorerInterface* colorer,
+    const TraceTableOptions& table_options) {
+  google::protobuf::Arena arena;
+  TF_ASSIGN_OR_RETURN(XSpace* xspace, session_snapshot.GetXSpace(0, &arena));
+  PreprocessSingleHostXSpace(xspace, /*step_grouping=*/true,
+                             /*derived_timeline=*/true);
+  ProcessMegascaleDcn(xspace);
+  TraceEventsContainer trace_container;
+  ConvertXSpaceToTraceEventsContainer(host_name, *xspace, &trace_container);
+  std::unique_ptr<tsl::WritableFile> file;
+  TF_RETURN_IF_ERROR(tsl::Env::Default()->NewWritableFile(sstable_path, &file));
+  return trace_container.StoreAsLevelDbTable(std::move(file), colorer,
+                                             table_options);
+}
+
 absl::StatusOr<std::string> ConvertXSpaceToTraceEvents(
     const SessionSnapshot& session_snapshot, const absl::string_view tool_name,
     const ToolOptions& options) {
@@ -110,29 +202,50 @@ absl::StatusOr<std::string> ConvertXSpaceToTraceEvents(
         session_snapshot.XSpaceSize());
   }
 
-  google::protobuf::Arena arena;
-  TF_ASSIGN_OR_RETURN(XSpace* xspace, session_snapshot.GetXSpace(0, &arena));
-  PreprocessSingleHostXSpace(xspace, /*step_grouping=*/true,
-                             /*derived_timeline=*/true);
   std::string content;
   if (tool_name == "trace_viewer") {
+    google::protobuf::Arena arena;
+    TF_ASSIGN_OR_RETURN(XSpace* xspace, session_snapshot.GetXSpace(0, &arena));
+    PreprocessSingleHostXSpace(xspace, /*step_grouping=*/true,
+                               /*derived_timeline=*/true);
     tsl::profiler::ConvertXSpaceToTraceEventsString(*xspace, &content);
+    // Keep the response loadable in the browser: beyond the event budget, send
+    // only the events the streaming trace viewer shows at coarse zoom levels.
+    // The budget bounds the response size, not the conversion: the full trace
+    // is still built here, so peak memory grows with the whole trace.
+    int max_events = GetParamWithDefault<int>(options, "max_events",
+                                              kTraceViewerMaxEvents);
+    if (max_events >= 0) {
+      // Most traces fit, so the events are counted without parsing them.
+      TF_ASSIGN_OR_RETURN(size_t num_events, CountLegacyTraceEvents(content));
+      if (num_events > max_events) {
+        ::xprof::Trace trace;
+        if (!trace.ParseFromString(content)) {
+          return tsl::errors::Internal("Failed to parse trace events.");
+        }
+        MaybeDropLegacyTraceEvents(max_events, &trace);
+        content = trace.SerializeAsString();
+      }
+    }
     return content;
   } else {  // streaming trace viewer.
     std::string host_name = session_snapshot.GetHostname(0);
     auto sstable_path = session_snapshot.GetFilePath(tool_name, host_name);
     if (!sstable_path) {
       return tsl::errors::Unimplemented(
-          "streaming trace viewer hasn't been supported in Cloud AI");
+          "streaming trace viewer needs a fast file location for sessions "
+          "without an accessible run dir; see RegisterFastFileLocator");
     }
+    // The trace viewer colorer. It colors the events when the table is built,
+    // and tables built by older versions are colored when serving.
+    DefaultTraceEventsColorer colorer;
+    // Viewport requests after the first one are served from the table alone.
     if (!tsl::Env::Default()->FileExists(*sstable_path).ok()) {
-      ProcessMegascaleDcn(xspace);
-      TraceEventsContainer trace_container;
-      ConvertXSpaceToTraceEventsContainer(host_name, *xspace, &trace_container);
-      std::unique_ptr<tsl::WritableFile> file;
-      TF_RETURN_IF_ERROR(
-          tsl::Env::Default()->NewWritableFile(*sstable_path, &file));
-      TF_RETURN_IF_ERROR(trace_container.StoreAsLevelDbTable(std::move(file)));
+      TF_ASSIGN_OR_RETURN(TraceTableOptions table_options,
+                          GetTraceTableOptions(options));
+      TF_RETURN_IF_ERROR(BuildTraceEventsLevelDbTable(
+          session_snapshot, host_name, *sstable_path, &colorer,
+          table_options));
     }
     TF_ASSIGN_OR_RETURN(TraceViewOption trace_option,
                         GetTraceViewOption(options));
@@ -147,6 +260,7 @@ absl::StatusOr<std::string> ConvertXSpaceToTraceEvents(
         *sstable_path, /*filter=*/nullptr, std::move(visibility_filter),
         kDisableStreamingThreshold));
     JsonTraceOptions options;
+    options.colorer = &colorer;
     IOBufferAdapter adapter(&content);
     TraceEventsToJson<IOBufferAdapter, TraceEventsContainer, RawData>(
         options, trace_container, &adapter);
@@ -159,13 +273,14 @@ absl::StatusOr<std::string> ConvertMultiXSpacesToOverviewPage(
   OpStats combined_op_stats;
   TF_RETURN_IF_ERROR(ConvertMultiXSpaceToCombinedOpStatsWithCache(
       session_snapshot, &combined_op_stats));
+  // Only the overview page needs the inference latency, so it is added to the
+  // cached OpStats here rather than when they are first built.
+  TF_RETURN_IF_ERROR(
+      AddInferenceLatencyWithCache(session_snapshot, &combined_op_stats));
   OverviewPage overview_page = ConvertOpStatsToOverviewPage(combined_op_stats);
-  if (!combined_op_stats.run_environment().is_training()) {
-    InferenceStats inference_stats;
-    TF_RETURN_IF_ERROR(ConvertMultiXSpaceToInferenceStats(
-        session_snapshot, "", "", &inference_stats));
+  if (combined_op_stats.has_inference_latency()) {
     *overview_page.mutable_inference_latency() =
-        ComputeInferenceLatencyResult(inference_stats);
+        combined_op_stats.inference_latency();
   }
   return OverviewPageToJson(overview_page);
 }
@@ -357,6 +472,86 @@ absl::StatusOr<std::string> ConvertMultiXSpacesToInferenceStats(
   return InferenceStatsToDataTableJson(inference_stats);
 }
 
+absl::StatusOr<std::string> ConvertMultiXSpacesToOpStatsDiff(
+    const SessionSnapshot& session_snapshot, const ToolOptions& options) {
+  // <options> must provide the comma separated XSpace paths of the baseline
+  // session. The profile plugin resolves them from the baseline run, the same
+  // way it resolves the paths of this session.
+  std::vector<std::string> baseline_xspace_paths = absl::StrSplit(
+      GetParamWithDefault<std::string>(options, "baseline_xspace_paths", ""),
+      ',', absl::SkipEmpty());
+  if (baseline_xspace_paths.empty()) {
+    return absl::InvalidArgumentError(
+        "Cannot find baseline_xspace_paths from options for op_stats_diff "
+        "tool.");
+  }
+  OpStatsDiffOptions diff_options;
+  auto min_delta_us = GetParamWithDefault<std::string>(
+      options, "min_delta_us", absl::StrCat(diff_options.min_delta_us));
+  auto min_relative_delta = GetParamWithDefault<std::string>(
+      options, "min_relative_delta",
+      absl::StrCat(diff_options.min_relative_delta));
+  if (!absl::SimpleAtod(min_delta_us, &diff_options.min_delta_us) ||
+      !absl::SimpleAtod(min_relative_delta,
+                        &diff_options.min_relative_delta)) {
+    return tsl::errors::InvalidArgument("wrong arguments");
+  }
+
+  TF_ASSIGN_OR_RETURN(
+      SessionSnapshot baseline_session_snapshot,
+      SessionSnapshot::Create(std::move(baseline_xspace_paths),
+                              /*xspaces=*/std::nullopt));
+  OpStats baseline_op_stats;
+  TF_RETURN_IF_ERROR(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      baseline_session_snapshot, &baseline_op_stats));
+  OpStats combined_op_stats;
+  TF_RETURN_IF_ERROR(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      session_snapshot, &combined_op_stats));
+  TF_ASSIGN_OR_RETURN(
+      OpStatsDiff diff,
+      ComputeOpStatsDiff(baseline_op_stats, combined_op_stats, diff_options));
+  return OpStatsDiffToDataTableJson(diff);
+}
+
+absl::StatusOr<std::string> ConvertMultiXSpacesToOpMetricsQuery(
+    const SessionSnapshot& session_snapshot, const ToolOptions& options) {
+  // Parse the query before loading the OpStats so that typos fail fast.
+  TF_ASSIGN_OR_RETURN(
+      OpMetricsQuery query,
+      ParseOpMetricsQuery(
+          GetParamWithDefault<std::string>(options, "query", "")));
+  // With a slice duration, the query runs over each time slice of the device
+  // ops and returns a JSON array of DataTables, one per non-empty slice.
+  int slice_duration_ms =
+      GetParamWithDefault<int>(options, "slice_duration_ms", 0);
+  if (slice_duration_ms > 0) {
+    OpStats op_stats;
+    TF_RETURN_IF_ERROR(ConvertMultiXSpacesToTimeSlicedOpStatsWithCache(
+        session_snapshot, tsl::profiler::MilliToPico(slice_duration_ms),
+        &op_stats));
+    std::vector<std::string> slice_tables;
+    for (const OpMetricsDbSlice& slice :
+         op_stats.time_sliced_device_op_metrics_db().slices()) {
+      TF_ASSIGN_OR_RETURN(std::unique_ptr<DataTable> data_table,
+                          RunOpMetricsQuery(slice.op_metrics_db(), query));
+      data_table->AddCustomProperty("begin_ps",
+                                    absl::StrCat(slice.begin_ps()));
+      slice_tables.push_back(data_table->ToJson());
+    }
+    return absl::StrCat("[", absl::StrJoin(slice_tables, ","), "]");
+  }
+  OpStats combined_op_stats;
+  TF_RETURN_IF_ERROR(ConvertMultiXSpaceToCombinedOpStatsWithCache(
+      session_snapshot, &combined_op_stats));
+  const OpMetricsDb& op_metrics_db =
+      combined_op_stats.device_op_metrics_db().metrics_db().empty()
+          ? combined_op_stats.host_op_metrics_db()
+          : combined_op_stats.device_op_metrics_db();
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<DataTable> data_table,
+                      RunOpMetricsQuery(op_metrics_db, query));
+  return data_table->ToJson();
+}
+
 }  // namespace
 
 absl::StatusOr<std::string> ConvertMultiXSpacesToToolData(
@@ -401,6 +596,10 @@ absl::StatusOr<std::string> ConvertMultiXSpacesToToolData(
     return PreprocessXSpace(session_snapshot);
   } else if (tool_name == "inference_profile") {
     return ConvertMultiXSpacesToInferenceStats(session_snapshot, options);
+  } else if (tool_name == "op_stats_diff") {
+    return ConvertMultiXSpacesToOpStatsDiff(session_snapshot, options);
+  } else if (tool_name == "op_metrics_query") {
+    return ConvertMultiXSpacesToOpMetricsQuery(session_snapshot, options);
   } else {
     return tsl::errors::InvalidArgument(
         "Can not find tool: ", tool_name,
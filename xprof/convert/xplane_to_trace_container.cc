@@ -22,6 +22,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "xla/tsl/profiler/utils/tf_xplane_visitor.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "xla/tsl/profiler/utils/xplane_utils.h"
 #include "xla/tsl/profiler/utils/xplane_visitor.h"
 #include "xprof/convert/trace_viewer/trace_event_arguments_builder.h"
+#include "xprof/convert/trace_viewer/trace_events.h"
 #include "xprof/convert/trace_viewer/trace_events_util.h"
 #include "plugin/xprof/protobuf/trace_events.pb.h"
 #include "plugin/xprof/protobuf/trace_events_raw.pb.h"
@@ -126,8 +128,57 @@ SpecialArguments ConvertXStatsToTraceEventArguments(
   return special_args;
 }
 
+// Name and long_name argument shared by all events of an XEventMetadata.
+struct EventMetadataNames {
+  TraceEventName name;
+  // Reference to the interned, truncated long_name argument, if the event has
+  // a display name and its full name is long enough to be interned.
+  std::optional<uint64_t> long_name_ref;
+};
+
+// Truncates and interns the names of each XEventMetadata once, so events with
+// very long (e.g. fused HLO) names don't copy or hash them per event.
+class EventMetadataNamesCache {
+ public:
+  explicit EventMetadataNamesCache(TraceEventsContainer* container)
+      : container_(container) {}
+
+  const EventMetadataNames& Get(const XEventVisitor& event) {
+    auto [it, inserted] = names_by_metadata_id_.try_emplace(event.Id());
+    if (inserted) {
+      EventMetadataNames& names = it->second;
+      names.name = container_->MaybeInternName(
+          event.HasDisplayName() ? event.DisplayName() : event.Name());
+      if (event.HasDisplayName()) {
+        std::string long_name = TruncateLongName(event.Name());
+        if (long_name.size() >
+            TraceEventsContainer::kTraceArgInternThreshold) {
+          // Also mark it as potential stack frame.
+          names.long_name_ref =
+              container_->InternString(absl::StrCat("@@", long_name));
+        }
+      }
+    }
+    return it->second;
+  }
+
+ private:
+  static std::string TruncateLongName(absl::string_view name) {
+    constexpr size_t kMaxLongName = 10000;
+    if (name.size() > kMaxLongName) {
+      return absl::StrCat(name.substr(0, kMaxLongName), "...<truncated>");
+    }
+    return std::string(name);
+  }
+
+  TraceEventsContainer* container_;
+  absl::flat_hash_map<int64_t /*metadata_id*/, EventMetadataNames>
+      names_by_metadata_id_;
+};
+
 void ConvertXLineToTraceEventsContainer(uint32_t device_id,
                                         const XLineVisitor& line,
+                                        EventMetadataNamesCache& names_cache,
                                         TraceEventsContainer* container) {
   std::optional<uint32_t> resource_id;
 
@@ -140,35 +191,34 @@ void ConvertXLineToTraceEventsContainer(uint32_t device_id,
   }
 
   RawData raw_data;  // hoisted for performance
-  line.ForEachEvent([device_id, resource_id, &raw_data,
+  line.ForEachEvent([device_id, resource_id, &raw_data, &names_cache,
                      container](const XEventVisitor& event) {
     int64_t event_type =
         event.Type().value_or(HostEventType::kUnknownHostEventType);
     if (tsl::profiler::IsInternalEvent(event_type)) return;
     TraceEventArguments* raw_args = raw_data.mutable_args();
-    absl::string_view event_name;
+    const EventMetadataNames& names = names_cache.Get(event);
     if (event.HasDisplayName()) {
-      event_name = event.DisplayName();
       TraceEventArgumentsBuilder args(raw_args);
-      constexpr size_t kMaxLongName = 10000;
-      if (event.Name().size() > kMaxLongName) {
-        args.Append("long_name",
-                    absl::StrCat(event.Name().substr(0, kMaxLongName),
-                                 "...<truncated>"));
+      if (names.long_name_ref) {
+        args.AppendRef("long_name", *names.long_name_ref);
       } else {
         args.Append("long_name", event.Name());
       }
-    } else {
-      event_name = event.Name();
     }
     SpecialArguments special_args =
         ConvertXStatsToTraceEventArguments(event, &raw_data, raw_args);
+    TraceEventName event_name = names.name;
     if (!special_args.step_name.empty()) {
       event_name = special_args.step_name;
     }
     if (!resource_id) {
-      container->AddCounterEvent(event_name, device_id, event.TimestampPs(),
-                                 raw_data);
+      // Counter events are grouped by name, so they need the name itself.
+      container->AddCounterEvent(
+          !special_args.step_name.empty() ? special_args.step_name
+          : event.HasDisplayName()        ? event.DisplayName()
+                                          : event.Name(),
+          device_id, event.TimestampPs(), raw_data);
     } else if (special_args.flow) {
       tsl::profiler::Timespan span(event.TimestampPs(), event.DurationPs());
       if (special_args.is_async_event) {
@@ -208,12 +258,14 @@ void ConvertXPlaneToTraceEventsContainer(uint64_t device_id,
     device->set_name(absl::StrCat(hostname, " ", name));
   }
 
+  EventMetadataNamesCache names_cache(container);
   plane.ForEachLine([&](const XLineVisitor& line) {
     if (line.DisplayName() == tsl::profiler::kXlaAsyncOpLineName) return;
     if (line.NumEvents() == 0) return;
     // Capture a copy of XLineVisitor because it will go out of scope.
     uint32_t device_id = resource_grouper->GetDeviceId(line.DisplayId());
-    ConvertXLineToTraceEventsContainer(device_id, line, container);
+    ConvertXLineToTraceEventsContainer(device_id, line, names_cache,
+                                       container);
   });
 }
 
@@ -247,6 +299,7 @@ void ConvertXSpaceToTraceEventsContainer(absl::string_view hostname,
         tsl::profiler::kFirstCustomPlaneDeviceId + custom_plane->id(), hostname,
         *custom_plane, container);
   }
+  container->SortTracks();
 }
 
 }  // namespace profiler
@@ -17,12 +17,14 @@ limitations under the License.
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "testing/base/public/gmock.h"
 #include "<gtest/gtest.h>"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "xla/tsl/profiler/utils/math_utils.h"
 #include "xprof/utils/tensorflow_utils.h"
@@ -117,6 +119,44 @@ TEST(XPlaneToTraceContainerTest, CounterLine) {
                                     Pair(tsl::profiler::UniToPico(2), 400)))));
 }
 
+TEST(XPlaneToTraceContainerTest, LongNameIsTruncatedAndInternedOnce) {
+  const std::string long_name(20000, 'x');
+  XSpace xspace;
+  CHECK_OK(ParseTextFormatFromString(
+      absl::Substitute(
+          "planes {"
+          "  name: \"/device:GPU:0\""
+          "  lines {"
+          "    id: 14"
+          "    name: \"Stream #14(Compute)\""
+          "    events { metadata_id: 10 offset_ps: 0 duration_ps: 10 }"
+          "    events { metadata_id: 10 offset_ps: 100 duration_ps: 10 }"
+          "  }"
+          "  event_metadata {"
+          "    key: 10"
+          "    value: { id: 10 name: \"$0\" display_name: \"fusion\" }"
+          "  }"
+          "}",
+          long_name),
+      &xspace));
+  TraceEventsContainer container;
+  ConvertXSpaceToTraceEventsContainer("localhost", xspace, &container);
+
+  std::vector<uint64_t> long_name_refs;
+  container.ForAllEvents([&](const TraceEvent& event) {
+    EXPECT_EQ(event.name(), "fusion");
+    RawData raw_data;
+    raw_data.ParseFromString(
+        std::string(EventRawData(container.trace(), event)));
+    ASSERT_EQ(raw_data.args().arg(0).name(), "long_name");
+    long_name_refs.push_back(raw_data.args().arg(0).ref_value());
+  });
+  ASSERT_EQ(long_name_refs.size(), 2);
+  EXPECT_EQ(long_name_refs[0], long_name_refs[1]);
+  EXPECT_EQ(container.trace().name_table().at(long_name_refs[0]),
+            absl::StrCat("@@", long_name.substr(0, 10000), "...<truncated>"));
+}
+
 }  // namespace
 }  // namespace profiler
 }  // namespace tensorflow
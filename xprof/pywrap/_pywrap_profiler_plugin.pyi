@@ -13,7 +13,9 @@
 # limitations under the License.
 # ==============================================================================
 
+def legacy_trace_to_json(arg0: bytes) -> bytes: ...
 def monitor(arg0: str, arg1: int, arg2: int, arg3: bool) -> str: ...
+def register_fast_file_dir(arg0: str) -> None: ...
 def trace(arg0: str, arg1: str, arg2: str, arg3: bool, arg4: int, arg5: int, arg6: dict) -> None: ...
 def xspace_to_tools_data(arg0: list, arg1: str, arg2: dict = ...) -> tuple: ...
 def xspace_to_tools_data_from_byte_string(arg0: list, arg1: list, arg2: str, arg3: dict) -> tuple: ...
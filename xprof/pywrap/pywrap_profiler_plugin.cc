@@ -17,7 +17,9 @@ limitations under the License.
 #include "xla/pjrt/status_casters.h"
 #include "xla/tsl/platform/types.h"
 #include "xla/tsl/profiler/rpc/client/capture_profile.h"
+#include "xprof/convert/repository.h"
 #include "xprof/convert/tool_options.h"
+#include "xprof/convert/trace_viewer/legacy_trace_to_json.h"
 #include "xprof/pywrap/profiler_plugin_impl.h"
 
 namespace py = ::pybind11;
@@ -85,6 +87,17 @@ PYBIND11_MODULE(_pywrap_profiler_plugin, m) {
     return content;
   });
 
+  // Stores the fast files of sessions without an accessible run dir in
+  // <fast_file_dir>. An empty directory unregisters it.
+  m.def("register_fast_file_dir", [](const std::string& fast_file_dir) {
+    if (fast_file_dir.empty()) {
+      tensorflow::profiler::RegisterFastFileLocator(nullptr);
+    } else {
+      tensorflow::profiler::RegisterFastFileLocator(
+          tensorflow::profiler::ScratchDirFastFileLocator(fast_file_dir));
+    }
+  });
+
   m.def(
       "xspace_to_tools_data",
       [](const py::list& xspace_path_list, const py::str& py_tool_name,
@@ -147,6 +160,19 @@ PYBIND11_MODULE(_pywrap_profiler_plugin, m) {
                               py::bool_(result->second));
       },
       py::arg(), py::arg(), py::arg(), py::arg() = py::dict());
+
+  m.def("legacy_trace_to_json", [](const py::bytes& py_raw_trace) {
+    std::string raw_trace = std::string(py_raw_trace);
+    absl::StatusOr<std::string> result;
+    {
+      py::gil_scoped_release release;
+      result = tensorflow::profiler::LegacyTraceToJson(raw_trace);
+    }
+    if (!result.ok()) {
+      xla::ThrowIfError(result.status());
+    }
+    return py::bytes(*result);
+  });
 };
 
 }  // namespace
@@ -183,6 +183,7 @@ std::vector<int64_t> DeriveEventsFromAnnotationsForLines(
     const ScopeRangeIdTree* scope_range_id_tree = nullptr) {
   XPlaneVisitor plane_visitor =
       tsl::profiler::CreateTfXPlaneVisitor(device_trace);
+  GpuEventStatTypes stat_types(*device_trace);
 
   XPlaneBuilder plane_builder(device_trace);
   int64_t start_timestamp_ns =
@@ -216,7 +217,7 @@ std::vector<int64_t> DeriveEventsFromAnnotationsForLines(
   for (const XEventVisitor& event :
        tsl::profiler::GetSortedEvents<XEventVisitor>(plane_visitor, false,
                                                      line_ids)) {
-    GpuEventStats stats(&event);
+    GpuEventStats stats(&event, stat_types);
     // For HLO/TF op lines, only use kernel events (i.e. excluding memcpy or
     // allocation events). Also CudaGraph executions are also treated as
     // kernel events.
@@ -567,6 +568,7 @@ void DeriveEventsFromHostTrace(
   std::vector<DeviceLaunchInfo> per_device_launch_info(num_devices);
 
   XPlaneVisitor host_plane = tsl::profiler::CreateTfXPlaneVisitor(host_trace);
+  GpuEventStatTypes host_stat_types(*host_trace);
   host_plane.ForEachLine([&](const XLineVisitor& line) {
     if (tsl::profiler::IsDerivedThreadId(line.Id())) return;
     line.ForEachEvent([&](const XEventVisitor& event) {
@@ -574,7 +576,7 @@ void DeriveEventsFromHostTrace(
       // etc for now. TODO: find a better way to filter out only the memcpy and
       // kernel launch events.
       if (absl::StartsWith(event.Name(), "cu")) return;
-      LaunchEventStats stats(&event);
+      LaunchEventStats stats(&event, host_stat_types);
       if (stats.group_id.has_value() && stats.IsLaunch() &&
           0 <= *stats.device_id && *stats.device_id < num_devices) {
         // This is a launch event on a known device.
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "xprof/utils/diagnostics.h"
 
+#include <cstdint>
 #include <string>
+#include <utility>
 
 #include "absl/algorithm/container.h"
 #include "absl/strings/str_cat.h"
@@ -55,7 +57,16 @@ const absl::string_view kStepsDropped =
     "steps. You could try to profile shorter or reduce the number of hosts "
     "you profile.";
 
-void PopulateStepDiagnostics(const OpStats& op_stats, Diagnostics* diag) {
+namespace {
+
+// A diagnostic check, along with the OpStats sections it reads.
+struct DiagnosticCheck {
+  // Bitmask of OpStatsSection.
+  uint32_t sections;
+  void (*check)(const OpStats& op_stats, Diagnostics* diag);
+};
+
+void CheckStepMarkers(const OpStats& op_stats, Diagnostics* diag) {
   if (op_stats.step_db().use_incomplete_step()) {
     *diag->add_warnings() = std::string(kErrorIncompleteStep);
   } else if (op_stats.step_db().step_sequence().empty()) {
@@ -63,12 +74,44 @@ void PopulateStepDiagnostics(const OpStats& op_stats, Diagnostics* diag) {
                                 ? std::string(kErrorEmptyIntersect)
                                 : std::string(kErrorNoStepMarker);
   }
+}
+
+void CheckStepsDropped(const OpStats& op_stats, Diagnostics* diag) {
   if (op_stats.step_db().num_steps_dropped()) {
     *diag->add_warnings() =
         absl::StrCat(op_stats.step_db().num_steps_dropped(), kStepsDropped);
   }
 }
 
+constexpr DiagnosticCheck kDiagnosticChecks[] = {
+    {kOpStatsStepDb, CheckStepMarkers},
+    {kOpStatsStepDb, CheckStepsDropped},
+};
+
+// Evaluates the checks that read only the given OpStats sections.
+void EvaluateDiagnosticChecks(const OpStats& op_stats, uint32_t sections,
+                              Diagnostics* diag) {
+  for (const DiagnosticCheck& check : kDiagnosticChecks) {
+    if ((check.sections & ~sections) == 0) check.check(op_stats, diag);
+  }
+}
+
+}  // namespace
+
+void FinalizeStepDiagnostics(OpStats* op_stats) {
+  Diagnostics step_diagnostics;
+  EvaluateDiagnosticChecks(*op_stats, kOpStatsStepDb, &step_diagnostics);
+  *op_stats->mutable_step_diagnostics() = std::move(step_diagnostics);
+}
+
+void PopulateStepDiagnostics(const OpStats& op_stats, Diagnostics* diag) {
+  if (op_stats.has_step_diagnostics()) {
+    diag->MergeFrom(op_stats.step_diagnostics());
+    return;
+  }
+  EvaluateDiagnosticChecks(op_stats, kOpStatsStepDb, diag);
+}
+
 void PopulateOverviewDiagnostics(const OpStats& op_stats, Diagnostics* diag) {
   *diag->mutable_errors() = op_stats.diagnostics().errors();
   absl::c_sort(*diag->mutable_errors());
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef XPROF_UTILS_DIAGNOSTICS_H_
 #define XPROF_UTILS_DIAGNOSTICS_H_
 
+#include <cstdint>
+
 #include "absl/strings/string_view.h"
 #include "xla/tsl/platform/macros.h"
 #include "plugin/xprof/protobuf/diagnostics.pb.h"
@@ -35,6 +37,18 @@ TF_CONST_INIT extern const absl::string_view kNoDeviceTraceCollected;
 
 TF_CONST_INIT extern const absl::string_view kStepsDropped;
 
+// The OpStats sections that diagnostic checks read.
+enum OpStatsSection : uint32_t {
+  kOpStatsStepDb = 1 << 0,
+};
+
+// Evaluates the diagnostic checks that read only the step database and stores
+// their results in op_stats->step_diagnostics(). Must be called after the step
+// database is final.
+void FinalizeStepDiagnostics(OpStats* op_stats);
+
+// Adds the step database diagnostics to <diag>, using the ones stored by
+// FinalizeStepDiagnostics if present.
 void PopulateStepDiagnostics(const OpStats& op_stats, Diagnostics* diag);
 
 void PopulateOverviewDiagnostics(const OpStats& op_stats, Diagnostics* diag);
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -200,7 +201,7 @@ class StepDetails {
   std::string DebugString() const;
 
   void SetPerCoreOpMetricsDb(OpMetricsDb db, uint32 core_id) {
-    per_core_op_metrics_db_[core_id] = db;
+    per_core_op_metrics_db_[core_id] = std::move(db);
   }
 
  private:
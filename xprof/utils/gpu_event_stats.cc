@@ -16,11 +16,13 @@ limitations under the License.
 #include "xprof/utils/gpu_event_stats.h"
 
 #include <cstdint>
+#include <optional>
 
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "xla/tsl/profiler/utils/xplane_schema.h"
 #include "xla/tsl/profiler/utils/xplane_visitor.h"
+#include "tsl/profiler/protobuf/xplane.pb.h"
 
 namespace tensorflow {
 namespace profiler {
@@ -28,82 +30,122 @@ namespace {
 
 const absl::string_view kAnnotationDelimiter = "::";
 
+// Stat metadata IDs below twice the number of stat metadata plus this slack
+// are stored in the dense table.
+constexpr int64_t kMaxDenseStatMetadataIdSlack = 64;
+
+int64_t IntOrUintValue(const XStat& stat) {
+  return stat.value_case() == XStat::kUint64Value
+             ? static_cast<int64_t>(stat.uint64_value())
+             : stat.int64_value();
 }
 
+}  // namespace
+
 using ::tsl::profiler::StatType;
 using ::tsl::profiler::XEventVisitor;
-using ::tsl::profiler::XStatVisitor;
 
-GpuEventStats::GpuEventStats(const XEventVisitor* event) {
-  event->ForEachStat([&](const XStatVisitor& stat) {
-    if (!stat.Type().has_value()) return;
-    switch (stat.Type().value()) {
+GpuEventStatTypes::GpuEventStatTypes(const XPlane& plane) : plane_(&plane) {
+  const int64_t max_dense_id =
+      2 * plane.stat_metadata_size() + kMaxDenseStatMetadataIdSlack;
+  for (const auto& [id, metadata] : plane.stat_metadata()) {
+    std::optional<int64_t> type = tsl::profiler::FindStatType(metadata.name());
+    if (!type.has_value()) continue;
+    if (id >= 0 && id < max_dense_id) {
+      if (id >= static_cast<int64_t>(dense_types_.size())) {
+        dense_types_.resize(id + 1, tsl::profiler::kUnknownStatType);
+      }
+      dense_types_[id] = *type;
+    } else {
+      sparse_types_[id] = *type;
+    }
+  }
+}
+
+absl::string_view GpuEventStatTypes::StrOrRefValue(const XStat& stat) const {
+  switch (stat.value_case()) {
+    case XStat::kStrValue:
+      return stat.str_value();
+    case XStat::kRefValue: {
+      auto it = plane_->stat_metadata().find(stat.ref_value());
+      return it != plane_->stat_metadata().end() ? it->second.name()
+                                                 : absl::string_view();
+    }
+    default:
+      return absl::string_view();
+  }
+}
+
+GpuEventStats::GpuEventStats(const XEventVisitor* event,
+                             const GpuEventStatTypes& stat_types) {
+  for (const XStat& stat : event->RawEvent().stats()) {
+    switch (stat_types.Get(stat.metadata_id())) {
       case StatType::kTfOp:
-        tf_op_fullname = stat.StrOrRefValue();
+        tf_op_fullname = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kEquation:
-        equation = stat.StrOrRefValue();
+        equation = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kTensorShapes:
-        tensor_shapes = stat.StrOrRefValue();
+        tensor_shapes = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kHloOp:
-        hlo_op_names =
-            absl::StrSplit(stat.StrOrRefValue(), kAnnotationDelimiter);
+        hlo_op_names = absl::StrSplit(stat_types.StrOrRefValue(stat),
+                                      kAnnotationDelimiter);
         break;
       case StatType::kHloModule:
-        hlo_module_name = stat.StrOrRefValue();
+        hlo_module_name = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kProgramId:
-        program_id = stat.IntOrUintValue();
+        program_id = IntOrUintValue(stat);
         break;
       case StatType::kKernelDetails:
-        kernel_details = stat.StrOrRefValue();
+        kernel_details = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kMemcpyDetails:
-        memcpy_details = stat.StrOrRefValue();
+        memcpy_details = stat_types.StrOrRefValue(stat);
         break;
       case StatType::kCorrelationId:
-        correlation_id = static_cast<int64_t>(stat.IntOrUintValue());
+        correlation_id = IntOrUintValue(stat);
         break;
       case StatType::kGroupId:
-        group_id = stat.IntValue();
+        group_id = stat.int64_value();
         break;
       case StatType::kIsEager:
-        is_eager = stat.BoolValue();
+        is_eager = stat.int64_value() != 0;
         break;
       case StatType::kCudaGraphExecId:
-        cuda_graph_exec_id = stat.UintValue();
+        cuda_graph_exec_id = stat.uint64_value();
         break;
       case StatType::kCudaGraphId:
-        cuda_graph_id_for_inner_node = stat.UintValue();
+        cuda_graph_id_for_inner_node = stat.uint64_value();
         break;
       case StatType::kScopeRangeId:
-        scope_range_id = stat.IntValue();
+        scope_range_id = stat.int64_value();
         break;
       default:
         break;
     }
-  });
+  }
 }
 
-LaunchEventStats::LaunchEventStats(const XEventVisitor* event) {
-  event->ForEachStat([&](const XStatVisitor& stat) {
-    if (!stat.Type().has_value()) return;
-    switch (stat.Type().value()) {
+LaunchEventStats::LaunchEventStats(const XEventVisitor* event,
+                                   const GpuEventStatTypes& stat_types) {
+  for (const XStat& stat : event->RawEvent().stats()) {
+    switch (stat_types.Get(stat.metadata_id())) {
       case StatType::kDeviceId:
-        device_id = stat.IntOrUintValue();
+        device_id = IntOrUintValue(stat);
         break;
       case StatType::kCorrelationId:
-        correlation_id = static_cast<int64_t>(stat.IntOrUintValue());
+        correlation_id = IntOrUintValue(stat);
         break;
       case StatType::kGroupId:
-        group_id = stat.IntValue();
+        group_id = stat.int64_value();
         break;
       default:
         break;
     }
-  });
+  }
 }
 
 }  // namespace profiler
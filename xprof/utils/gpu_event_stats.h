@@ -20,17 +20,51 @@ limitations under the License.
 #include <optional>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/string_view.h"
+#include "xla/tsl/profiler/utils/xplane_schema.h"
 #include "xla/tsl/profiler/utils/xplane_visitor.h"
+#include "tsl/profiler/protobuf/xplane.pb.h"
 
 namespace tensorflow {
 namespace profiler {
 
 using ::tsl::profiler::XEventVisitor;
 
+// The stat types of the stat metadata of an XPlane, precomputed once per plane
+// so that event stats can be extracted without a map lookup per stat.
+// The XPlane must outlive this object.
+class GpuEventStatTypes {
+ public:
+  explicit GpuEventStatTypes(const XPlane& plane);
+
+  // Returns the StatType of the given stat metadata ID, or kUnknownStatType.
+  int64_t Get(int64_t stat_metadata_id) const {
+    if (stat_metadata_id >= 0 &&
+        stat_metadata_id < static_cast<int64_t>(dense_types_.size())) {
+      return dense_types_[stat_metadata_id];
+    }
+    auto it = sparse_types_.find(stat_metadata_id);
+    return it != sparse_types_.end() ? it->second
+                                     : tsl::profiler::kUnknownStatType;
+  }
+
+  // Returns the string value of <stat>, resolving reference values.
+  absl::string_view StrOrRefValue(const XStat& stat) const;
+
+ private:
+  const XPlane* plane_;
+  // Stat types indexed by stat metadata ID. Stat metadata IDs are usually
+  // small and dense; the rare large IDs are kept in sparse_types_.
+  std::vector<int32_t> dense_types_;
+  absl::flat_hash_map<int64_t, int32_t> sparse_types_;
+};
+
 // Stats from a GPU stream XEvent.
 struct GpuEventStats {
-  explicit GpuEventStats(const XEventVisitor* event);
+  GpuEventStats(const XEventVisitor* event,
+                const GpuEventStatTypes& stat_types);
 
   bool IsKernel() const { return !kernel_details.empty(); }
   bool IsMemCpy() const { return !memcpy_details.empty(); }
@@ -45,7 +79,7 @@ struct GpuEventStats {
   absl::string_view tensor_shapes;
 
   // Stats from XLA.
-  std::vector<absl::string_view> hlo_op_names;
+  absl::InlinedVector<absl::string_view, 4> hlo_op_names;
   absl::string_view hlo_module_name;
   std::optional<uint64_t> program_id;
 
@@ -64,7 +98,8 @@ struct GpuEventStats {
 
 // Stats for a host-side GPU launch XEvent.
 struct LaunchEventStats {
-  explicit LaunchEventStats(const XEventVisitor* event);
+  LaunchEventStats(const XEventVisitor* event,
+                   const GpuEventStatTypes& stat_types);
 
   bool IsLaunch() const {
     return device_id.has_value() && correlation_id.has_value();
@@ -283,14 +283,15 @@ void XEventsOpMetricsDbBuilder::AddOpMetric(
   AddOpMetric(FromXEvent(event), GetOpKeyFromXEvent(event));
 }
 
-void XEventsOpMetricsDbBuilder::AddOpMetric(const OpMetrics& op_metrics,
+bool XEventsOpMetricsDbBuilder::AddOpMetric(const OpMetrics& op_metrics,
                                             const OpKey& key) {
   if (!key.program_id.has_value() || !key.symbol_id.has_value() ||
       key.symbol_id == kRootSymbolId)
-    return;
+    return false;
   MergeOpMetrics(
       op_metrics,
       flat_op_metric_[key.program_id.value()][key.symbol_id.value()]);
+  return true;
 }
 
 OpMetricsDb XEventsOpMetricsDbBuilder::Finalize(uint64_t total_time_ps) {
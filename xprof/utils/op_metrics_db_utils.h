@@ -78,8 +78,9 @@ class XEventsOpMetricsDbBuilder {
   // Add OpMetric from XEventVisitor.
   void AddOpMetric(const tsl::profiler::XEventVisitor& xevent);
 
-  // Add an OpMetric to the builder based on the provided key.
-  void AddOpMetric(const OpMetrics& op_metrics, const OpKey& key);
+  // Add an OpMetric to the builder based on the provided key. Returns false if
+  // the key does not identify an op, in which case the OpMetric is dropped.
+  bool AddOpMetric(const OpMetrics& op_metrics, const OpKey& key);
 
   // Finalize OpMetricDb and add total time and Idle op.
   OpMetricsDb Finalize(uint64_t total_time);